@@ -0,0 +1,356 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * A/B slot manager
+ *
+ * Two slots (boot partitions listed in variable ab_slots, e.g.
+ * "mmc0:1 mmc0:2") with priority, tries remaining and successful flag
+ * are kept in RTC SRAM next to the bootcount. Global bootmeth 'abslot'
+ * boots the slot with the highest priority which is successful or has
+ * tries left. A slot on trial loses one try before the jump.
+ *
+ * The OS confirms the boot by resetting bootcount. U-Boot stores
+ * bootcount=1 before the jump, so bootcount==1 after increment on the next
+ * boot means the last slot was confirmed and it is marked successful.
+ *
+ * Requests of older OS images (bootcount 101/102) boot slot A/B once,
+ * the way the old altbootcmd did, and leave the record alone. Without a
+ * valid record or such request the manager is inactive and the regular
+ * bootflow scan is used.
+ */
+
+#define LOG_CATEGORY UCLASS_BOOTSTD
+
+#include <bootcount.h>
+#include <bootflow.h>
+#include <bootmeth.h>
+#include <command.h>
+#include <dm.h>
+#include <env.h>
+#include <stdio.h>
+#include <u-boot/crc.h>
+#include <linux/errno.h>
+
+#include "unipi_system.h"
+
+#define ABSLOT_MAGIC		0xab
+#define ABSLOT_COUNT		2
+#define ABSLOT_PRIO_MASK	0x0f
+#define ABSLOT_TRIES_SHIFT	4
+#define ABSLOT_TRIES_MASK	(0x7 << ABSLOT_TRIES_SHIFT)
+#define ABSLOT_SUCCESSFUL	0x80
+#define ABSLOT_PRIO_MAX		15
+#define ABSLOT_TRIES_DEFAULT	3
+#define ABSLOT_TRIES_MAX	7
+#define ABSLOT_LEGACY_REQ	101
+
+struct abslot_rec {
+	u8 magic;
+	u8 cur;
+	u8 slot[ABSLOT_COUNT];
+	u8 crc;
+} __packed;
+
+static bool abslot_updated;
+
+static int abslot_prio(u8 slot)
+{
+	return slot & ABSLOT_PRIO_MASK;
+}
+
+static int abslot_tries(u8 slot)
+{
+	return (slot & ABSLOT_TRIES_MASK) >> ABSLOT_TRIES_SHIFT;
+}
+
+static u8 abslot_make(int prio, int tries, bool successful)
+{
+	return (prio & ABSLOT_PRIO_MASK) |
+	       ((tries << ABSLOT_TRIES_SHIFT) & ABSLOT_TRIES_MASK) |
+	       (successful ? ABSLOT_SUCCESSFUL : 0);
+}
+
+static int abslot_load(struct abslot_rec *rec)
+{
+	int ret;
+
+	ret = unipi_rtcram_read(UNIPI_RTCRAM_ABSLOT, (u8 *)rec, sizeof(*rec));
+	if (ret)
+		return ret;
+	if (rec->magic != ABSLOT_MAGIC || rec->cur >= ABSLOT_COUNT)
+		return -ENOENT;
+	if (crc8(0, (u8 *)rec, sizeof(*rec) - 1) != rec->crc)
+		return -EBADMSG;
+	return 0;
+}
+
+static int abslot_store(struct abslot_rec *rec)
+{
+	rec->magic = ABSLOT_MAGIC;
+	rec->crc = crc8(0, (u8 *)rec, sizeof(*rec) - 1);
+	return unipi_rtcram_write(UNIPI_RTCRAM_ABSLOT, (u8 *)rec, sizeof(*rec));
+}
+
+/* make slot n the first one, on trial */
+static void abslot_request(struct abslot_rec *rec, int n, int tries)
+{
+	int i;
+
+	for (i = 0; i < ABSLOT_COUNT; i++) {
+		if (abslot_prio(rec->slot[i]) == ABSLOT_PRIO_MAX)
+			rec->slot[i]--;
+	}
+	rec->slot[n] = abslot_make(ABSLOT_PRIO_MAX, tries, false);
+}
+
+static void abslot_set_bootcount(ulong count)
+{
+	bootcount_store(count);
+	env_set_ulong("bootcount", count);
+}
+
+/* slot requested by an older OS image (bootcount 101/102), or -ENOENT */
+static int abslot_legacy_request(void)
+{
+	ulong bootcount = env_get_ulong("bootcount", 10, 0);
+
+	if (bootcount == ABSLOT_LEGACY_REQ ||
+	    bootcount == ABSLOT_LEGACY_REQ + 1)
+		return bootcount - ABSLOT_LEGACY_REQ;
+	return -ENOENT;
+}
+
+/* the last slot was confirmed by the OS, mark it successful in rec */
+static bool abslot_confirm(struct abslot_rec *rec)
+{
+	if (env_get_ulong("bootcount", 10, 0) != 1 ||
+	    rec->slot[rec->cur] & ABSLOT_SUCCESSFUL)
+		return false;
+	rec->slot[rec->cur] = abslot_make(abslot_prio(rec->slot[rec->cur]),
+					  0, true);
+	return true;
+}
+
+/* record with the confirmation of the last boot applied, not stored */
+static int abslot_load_confirmed(struct abslot_rec *rec)
+{
+	int ret = abslot_load(rec);
+
+	if (!ret && !abslot_updated)
+		abslot_confirm(rec);
+	return ret;
+}
+
+/* once per session: store the confirmation of the last boot */
+static void abslot_update(void)
+{
+	struct abslot_rec rec;
+
+	if (abslot_updated)
+		return;
+	abslot_updated = true;
+
+	if (!abslot_load(&rec) && abslot_confirm(&rec))
+		abslot_store(&rec);
+}
+
+static int abslot_select(struct abslot_rec *rec)
+{
+	int i, best = -ENOENT;
+
+	for (i = 0; i < ABSLOT_COUNT; i++) {
+		u8 slot = rec->slot[i];
+
+		if (!abslot_prio(slot) ||
+		    (!(slot & ABSLOT_SUCCESSFUL) && !abslot_tries(slot)))
+			continue;
+		if (best < 0 || abslot_prio(slot) > abslot_prio(rec->slot[best]))
+			best = i;
+	}
+	return best;
+}
+
+/* label of slot n from variable ab_slots */
+static int abslot_label(int n, char *label, int size)
+{
+	const char *slots = env_get("ab_slots");
+	const char *end;
+
+	for (; slots && n > 0; n--) {
+		slots = strchr(slots, ' ');
+		if (slots)
+			slots++;
+	}
+	if (!slots || !*slots)
+		return -ENOENT;
+	end = strchrnul(slots, ' ');
+	if (end - slots >= size)
+		return -E2BIG;
+	strlcpy(label, slots, end - slots + 1);
+	return 0;
+}
+
+/* pure query, used by lastboot before the bootmeth runs */
+bool unipi_abslot_active(void)
+{
+	struct abslot_rec rec;
+
+	if (abslot_legacy_request() >= 0)
+		return true;
+	return !abslot_load_confirmed(&rec) && abslot_select(&rec) >= 0;
+}
+
+static int abslot_boot_label(const char *label)
+{
+	struct bootflow_iter iter;
+	struct bootflow bflow;
+	int ret, i;
+
+	for (i = 0, ret = bootflow_scan_first(NULL, label, &iter,
+					      BOOTFLOWIF_HUNT |
+					      BOOTFLOWIF_SKIP_GLOBAL, &bflow);
+	     i < 1000 && ret != -ENODEV;
+	     i++, ret = bootflow_scan_next(&iter, &bflow)) {
+		if (!ret)
+			bootflow_run_boot(&iter, &bflow);
+		bootflow_free(&bflow);
+	}
+	bootflow_iter_uninit(&iter);
+
+	return -ENOENT;
+}
+
+static int abslot_check(struct udevice *dev, struct bootflow_iter *iter)
+{
+	return bootflow_iter_check_system(iter);
+}
+
+static int abslot_read_bootflow(struct udevice *dev, struct bootflow *bflow)
+{
+	abslot_update();
+	if (!unipi_abslot_active())
+		return log_msg_ret("abslot", -ENOENT);
+
+	bflow->state = BOOTFLOWST_READY;
+	return 0;
+}
+
+static int abslot_boot(struct udevice *dev, struct bootflow *bflow)
+{
+	struct abslot_rec rec;
+	char label[16];
+	int n, tries;
+
+	/* one-shot, like 'bootcount reset; bootflow scan -b <slot>' */
+	n = abslot_legacy_request();
+	if (n >= 0) {
+		abslot_set_bootcount(0);
+		if (abslot_label(n, label, sizeof(label)) == 0) {
+			printf("ABSLOT: slot %c %s (requested)\n", 'A' + n,
+			       label);
+			abslot_boot_label(label);
+		}
+		/* failed, continue with the regular slot if there is one */
+	}
+
+	while (!abslot_load(&rec) && (n = abslot_select(&rec)) >= 0) {
+		/* commit the state before the jump */
+		tries = abslot_tries(rec.slot[n]);
+		if (!(rec.slot[n] & ABSLOT_SUCCESSFUL))
+			rec.slot[n] = abslot_make(abslot_prio(rec.slot[n]),
+						  tries - 1, false);
+		rec.cur = n;
+		abslot_store(&rec);
+		abslot_set_bootcount(1);
+
+		if (abslot_label(n, label, sizeof(label)) == 0) {
+			printf("ABSLOT: slot %c %s%s\n", 'A' + n, label,
+			       rec.slot[n] & ABSLOT_SUCCESSFUL ? "" : " (trial)");
+			abslot_boot_label(label);
+		}
+
+		/* slot can't be booted at all, don't try it again */
+		rec.slot[n] = abslot_make(abslot_prio(rec.slot[n]), 0, false);
+		abslot_store(&rec);
+	}
+	return log_msg_ret("abslot", -ENOENT);
+}
+
+static int abslot_bootmeth_bind(struct udevice *dev)
+{
+	struct bootmeth_uc_plat *plat = dev_get_uclass_plat(dev);
+
+	plat->desc = "A/B slot manager";
+	plat->flags = BOOTMETHF_GLOBAL;
+
+	return 0;
+}
+
+static struct bootmeth_ops abslot_bootmeth_ops = {
+	.check		= abslot_check,
+	.read_bootflow	= abslot_read_bootflow,
+	.boot		= abslot_boot,
+};
+
+U_BOOT_DRIVER(bootmeth_abslot) = {
+	.name		= "bootmeth_abslot",
+	.id		= UCLASS_BOOTMETH,
+	.ops		= &abslot_bootmeth_ops,
+	.bind		= abslot_bootmeth_bind,
+};
+
+static int do_abslot(struct cmd_tbl *cmdtp, int flag, int argc,
+		     char *const argv[])
+{
+	struct abslot_rec rec;
+	ulong tries;
+	int i, n;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	if (!strcmp(argv[1], "info")) {
+		if (abslot_load(&rec)) {
+			printf("A/B slots not initialized\n");
+			return CMD_RET_FAILURE;
+		}
+		for (i = 0; i < ABSLOT_COUNT; i++)
+			printf("%c%c prio %d tries %d%s\n",
+			       i == rec.cur ? '*' : ' ', 'A' + i,
+			       abslot_prio(rec.slot[i]),
+			       abslot_tries(rec.slot[i]),
+			       rec.slot[i] & ABSLOT_SUCCESSFUL ? " successful" : "");
+	} else if (!strcmp(argv[1], "try") && argc >= 3) {
+		n = argv[2][0] == 'b' || argv[2][0] == 'B' || argv[2][0] == '1';
+		tries = argc > 3 ? dectoul(argv[3], NULL) : ABSLOT_TRIES_DEFAULT;
+		if (!tries || tries > ABSLOT_TRIES_MAX) {
+			printf("tries must be 1..%d\n", ABSLOT_TRIES_MAX);
+			return CMD_RET_FAILURE;
+		}
+		if (abslot_load(&rec)) {
+			rec.cur = 1 - n;
+			rec.slot[1 - n] = abslot_make(ABSLOT_PRIO_MAX - 1, 0, true);
+		}
+		abslot_request(&rec, n, tries);
+		abslot_store(&rec);
+	} else if (!strcmp(argv[1], "clear")) {
+		memset(&rec, 0, sizeof(rec));
+		unipi_rtcram_write(UNIPI_RTCRAM_ABSLOT, (u8 *)&rec, sizeof(rec));
+	} else {
+		return CMD_RET_USAGE;
+	}
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(abslot, 4, 0, do_abslot,
+	   "A/B slot manager",
+	   "info - show slot state\n"
+	   "abslot try <a|b> [tries] - boot slot first, on trial\n"
+	   "abslot clear - disable the slot manager"
+);
@@ -0,0 +1,165 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * Block read-ahead and metadata cache sizing
+ *
+ * Filesystems read fragmented files in small pieces (a FAT cluster, an ext4
+ * extent) and every piece costs a full command round trip on SD cards.
+ * When small reads follow each other sequentially, a window of
+ * CONFIG_SYS_MALLOC_LEN / 32 is read at once and the next pieces are copied
+ * from it. Reads served from the window don't enter the generic block cache,
+ * which so keeps mostly metadata (superblock, group descriptors, inode
+ * tables, FAT). The generic cache is enlarged to CONFIG_SYS_MALLOC_LEN / 64,
+ * its LRU stays as is. Any write to the device drops the window, so does
+ * a switch of the hardware partition (eMMC boot areas share the blk_desc).
+ */
+
+#include <blk.h>
+#include <command.h>
+#include <dm.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <stdio.h>
+#include <linux/string.h>
+
+#include "unipi_system.h"
+
+#define BLKRA_WINDOW		(CONFIG_SYS_MALLOC_LEN / 32)
+#define BLKRA_META_SIZE		(CONFIG_SYS_MALLOC_LEN / 64)
+#define BLKRA_META_BLOCKS	8
+/* larger reads are efficient without help */
+#define BLKRA_MAX_REQ		(BLKRA_WINDOW / 2)
+
+struct blkra_state {
+	struct blk_desc *desc;	/* device of the window and of next */
+	int hwpart;
+	lbaint_t start;		/* window */
+	lbaint_t count;
+	lbaint_t next;		/* end of the last read */
+	void *buf;
+	ulong hits;
+	ulong misses;
+	ulong fills;
+};
+
+static struct blkra_state blkra;
+
+static void blkra_init(void)
+{
+	blkra.buf = malloc_cache_aligned(BLKRA_WINDOW);
+	blkcache_configure(BLKRA_META_BLOCKS,
+			   BLKRA_META_SIZE / (BLKRA_META_BLOCKS * 512));
+}
+
+static bool blkra_same(struct blk_desc *desc)
+{
+	return desc == blkra.desc && desc->hwpart == blkra.hwpart;
+}
+
+/* remember the end of a read, on another device without a window */
+static void blkra_seek(struct blk_desc *desc, lbaint_t next)
+{
+	if (!blkra_same(desc)) {
+		blkra.desc = desc;
+		blkra.hwpart = desc->hwpart;
+		blkra.count = 0;
+	}
+	blkra.next = next;
+}
+
+static int blkra_fill(struct blk_desc *desc, lbaint_t start)
+{
+	struct udevice *dev = desc->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+	lbaint_t count = BLKRA_WINDOW / desc->blksz;
+
+	/* past the end the driver reports the error, not the window */
+	if (start >= desc->lba)
+		return -EINVAL;
+	if (count > desc->lba - start)
+		count = desc->lba - start;
+	blkra.desc = NULL;
+	if (ops->read(dev, start, count, blkra.buf) != count)
+		return -EIO;
+	blkra.desc = desc;
+	blkra.hwpart = desc->hwpart;
+	blkra.start = start;
+	blkra.count = count;
+	blkra.fills++;
+	return 0;
+}
+
+/* called from blk_read() on miss of the block cache */
+ulong blk_readahead(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		    void *buf)
+{
+	bool sequential;
+
+	if (!blkra.buf) {
+		blkra_init();
+		if (!blkra.buf)
+			return 0;
+	}
+
+	if (blkcnt * desc->blksz > BLKRA_MAX_REQ) {
+		blkra_seek(desc, start + blkcnt);
+		return 0;
+	}
+
+	sequential = blkra_same(desc) && start == blkra.next;
+	if (!blkra_same(desc) || start < blkra.start ||
+	    start + blkcnt > blkra.start + blkra.count) {
+		blkra.misses++;
+		/* the first piece is read as is, the second one starts a window */
+		if (!sequential || blkra_fill(desc, start) ||
+		    blkcnt > blkra.count) {
+			/* remember the position only, there is no window */
+			blkra_seek(desc, start + blkcnt);
+			blkra.count = 0;
+			return 0;
+		}
+	} else {
+		blkra.hits++;
+	}
+
+	memcpy(buf, blkra.buf + (start - blkra.start) * desc->blksz,
+	       blkcnt * desc->blksz);
+	blkra.next = start + blkcnt;
+	return blkcnt;
+}
+
+/* called from blk_write() and blk_erase() */
+void blk_readahead_invalidate(struct blk_desc *desc)
+{
+	if (blkra.desc == desc)
+		blkra.desc = NULL;
+}
+
+/* counters are cleared by reading, like blkcache_stats() */
+static int do_blkstat(struct cmd_tbl *cmdtp, int flag, int argc,
+		      char *const argv[])
+{
+	struct block_cache_stats stats;
+
+	blkcache_stats(&stats);
+	printf("metadata:   hits %u misses %u entries %u/%u of %u blocks\n",
+	       stats.hits, stats.misses, stats.entries, stats.max_entries,
+	       stats.max_blocks_per_entry);
+	printf("read-ahead: hits %lu misses %lu windows %lu of %u KiB\n",
+	       blkra.hits, blkra.misses, blkra.fills, BLKRA_WINDOW / 1024);
+	blkra.hits = 0;
+	blkra.misses = 0;
+	blkra.fills = 0;
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(blkstat, 1, 0, do_blkstat,
+	   "show block cache hits and misses since the last call",
+	   ""
+);
@@ -0,0 +1,124 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * Skip GPT partitions which can't hold a bootflow
+ *
+ * Bootdevs call bootdev_part_filter() for every partition before the
+ * filesystem is probed, also for 'bootflow scan -b mmc0:N'. Partitions
+ * with type GUID listed in CONFIG_UNIPI_BOOTPART_SKIP_TYPES (swap by
+ * default) or with GPT attribute bit CONFIG_UNIPI_BOOTPART_NOBOOT_BIT set
+ * (data partitions) are skipped.
+ *
+ * The type GUID comes with the partition info. struct disk_partition has
+ * no attributes, they are read from the table once per device and kept
+ * until the device is written or gets a new medium.
+ */
+
+#include <blk.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <part.h>
+#include <part_efi.h>
+#include <linux/bitops.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+
+#include "unipi_system.h"
+
+#define BOOTPART_MAX		128
+
+static struct blk_desc *bootpart_desc;
+static int bootpart_count;
+static u64 bootpart_attrs[BOOTPART_MAX];
+
+/* attributes of all entries of the primary GPT */
+static int bootpart_read_attrs(struct blk_desc *desc)
+{
+	ALLOC_CACHE_ALIGN_BUFFER_PAD(gpt_header, gpt_h, 1, desc->blksz);
+	u32 esz, num, i;
+	lbaint_t blks;
+	gpt_entry *ent;
+	u8 *buf;
+
+	bootpart_desc = NULL;
+	if (blk_dread(desc, GPT_PRIMARY_PARTITION_TABLE_LBA, 1, gpt_h) != 1)
+		return -EIO;
+	if (le64_to_cpu(gpt_h->signature) != GPT_HEADER_SIGNATURE_UBOOT)
+		return -ENOENT;
+	esz = le32_to_cpu(gpt_h->sizeof_partition_entry);
+	num = min_t(u32, le32_to_cpu(gpt_h->num_partition_entries),
+		    BOOTPART_MAX);
+	if (esz < sizeof(*ent) || desc->blksz % esz)
+		return -ENOENT;
+
+	blks = DIV_ROUND_UP(num * esz, desc->blksz);
+	buf = malloc_cache_aligned(blks * desc->blksz);
+	if (!buf)
+		return -ENOMEM;
+	if (blk_dread(desc, le64_to_cpu(gpt_h->partition_entry_lba), blks,
+		      buf) != blks) {
+		free(buf);
+		return -EIO;
+	}
+	for (i = 0; i < num; i++) {
+		ent = (gpt_entry *)(buf + i * esz);
+		memcpy(&bootpart_attrs[i], &ent->attributes,
+		       sizeof(bootpart_attrs[i]));
+		bootpart_attrs[i] = le64_to_cpu(bootpart_attrs[i]);
+	}
+	free(buf);
+
+	bootpart_desc = desc;
+	bootpart_count = num;
+	return 0;
+}
+
+/* called from part_cache_invalidate(), the table may have changed */
+void unipi_bootpart_invalidate(struct blk_desc *desc)
+{
+	if (bootpart_desc == desc)
+		bootpart_desc = NULL;
+}
+
+static bool bootpart_type_skipped(const char *type)
+{
+	const char *list = CONFIG_UNIPI_BOOTPART_SKIP_TYPES;
+	int len = strlen(type);
+
+	if (!len)
+		return false;
+	while (*list) {
+		while (*list == ' ')
+			list++;
+		if (!strncasecmp(list, type, len) &&
+		    (list[len] == ' ' || list[len] == '\0'))
+			return true;
+		list = strchrnul(list, ' ');
+	}
+	return false;
+}
+
+/* called from bootdev_find_in_blk() before the filesystem is probed */
+int bootdev_part_filter(struct blk_desc *desc, int part,
+			struct disk_partition *info)
+{
+	if (desc->part_type != PART_TYPE_EFI)
+		return 0;
+
+	if (bootpart_type_skipped(disk_partition_type_guid(info)))
+		return -EINVAL;
+
+	if (bootpart_desc != desc && bootpart_read_attrs(desc))
+		return 0;
+	if (part >= 1 && part <= bootpart_count &&
+	    bootpart_attrs[part - 1] & BIT_ULL(CONFIG_UNIPI_BOOTPART_NOBOOT_BIT))
+		return -EINVAL;
+	return 0;
+}
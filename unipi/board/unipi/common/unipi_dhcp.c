@@ -0,0 +1,113 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * DHCP lease cache
+ *
+ * Address and expiry of the last DHCP lease are stored into RTC SRAM.
+ * While the lease is valid, the next 'dhcp' starts in INIT-REBOOT state
+ * (REQUEST of the cached address without DISCOVER/OFFER, broadcast and
+ * without server identifier as RFC 2131 requires). Server answers with
+ * ACK including boot file and options, or with NAK. After NAK or the first
+ * timeout the full DISCOVER is used.
+ *
+ * An infinite lease never expires. An ACK without lease time is kept for
+ * DHCP_LEASE_UNKNOWN seconds, the server confirms the address anyway.
+ */
+
+#include <net.h>
+#include <rtc.h>
+#include <u-boot/crc.h>
+#include <asm/unaligned.h>
+#include <linux/errno.h>
+
+#include "unipi_system.h"
+
+#define DHCP_LEASE_MAGIC	0xd5
+/* don't reuse a lease which is going to expire during boot */
+#define DHCP_LEASE_MARGIN	60
+#define DHCP_LEASE_INFINITE	0xffffffff
+#define DHCP_LEASE_UNKNOWN	3600
+
+struct dhcp_lease_rec {
+	u8 magic;
+	u8 ethidx;
+	u8 ip[4];
+	u8 expiry[4];
+	u8 crc;
+} __packed;
+
+static int dhcp_lease_load(struct dhcp_lease_rec *rec)
+{
+	int ret;
+
+	ret = unipi_rtcram_read(UNIPI_RTCRAM_DHCP, (u8 *)rec, sizeof(*rec));
+	if (ret)
+		return ret;
+	if (rec->magic != DHCP_LEASE_MAGIC)
+		return -ENOENT;
+	if (crc8(0, (u8 *)rec, sizeof(*rec) - 1) != rec->crc)
+		return -EBADMSG;
+	return 0;
+}
+
+/* called from bootp_request(), 0 means try INIT-REBOOT with *ip */
+int dhcp_lease_get(struct in_addr *ip)
+{
+	struct dhcp_lease_rec rec;
+	ulong now, expiry;
+
+	if (dhcp_lease_load(&rec))
+		return -ENOENT;
+	if (rec.ethidx != eth_get_dev_index())
+		return -ENOENT;
+	if (unipi_rtc_seconds(&now))
+		return -ENOENT;
+	expiry = get_unaligned_be32(rec.expiry);
+	if (expiry != DHCP_LEASE_INFINITE && now + DHCP_LEASE_MARGIN > expiry)
+		return -ETIMEDOUT;
+
+	memcpy(&ip->s_addr, rec.ip, sizeof(rec.ip));
+	printf("DHCP: requesting cached address %pI4\n", ip);
+	return 0;
+}
+
+/* called from dhcp_handler() when the client is bound */
+void dhcp_lease_store(struct in_addr ip, unsigned int lease_time)
+{
+	struct dhcp_lease_rec rec;
+	ulong now, expiry;
+
+	if (unipi_rtc_seconds(&now))
+		return;
+
+	if (!lease_time)
+		lease_time = DHCP_LEASE_UNKNOWN;
+	expiry = now + lease_time;
+	/* saturate, RTC seconds are 32 bit in the record */
+	if (lease_time == DHCP_LEASE_INFINITE || expiry >= DHCP_LEASE_INFINITE ||
+	    expiry < now)
+		expiry = DHCP_LEASE_INFINITE;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.magic = DHCP_LEASE_MAGIC;
+	rec.ethidx = eth_get_dev_index();
+	memcpy(rec.ip, &ip.s_addr, sizeof(rec.ip));
+	put_unaligned_be32(expiry, rec.expiry);
+	rec.crc = crc8(0, (u8 *)&rec, sizeof(rec) - 1);
+	unipi_rtcram_write(UNIPI_RTCRAM_DHCP, (u8 *)&rec, sizeof(rec));
+}
+
+/* called from dhcp_handler() on DHCPNAK in INIT-REBOOT state */
+void dhcp_lease_drop(void)
+{
+	struct dhcp_lease_rec rec;
+
+	memset(&rec, 0, sizeof(rec));
+	unipi_rtcram_write(UNIPI_RTCRAM_DHCP, (u8 *)&rec, sizeof(rec));
+}
@@ -0,0 +1,187 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * Table driven device tree fixups
+ *
+ * Every board describes its fixups as a compile-time table of nodes, each
+ * with a list of properties to copy from the source tree (the one U-Boot
+ * was started with), to set to a constant or computed string, or to set
+ * from the board EEPROM.
+ *
+ * All values are resolved first, each source node is looked up once. The
+ * space for all of them is reserved in one step, then every node of the
+ * destination tree is looked up (or created) once and its properties are
+ * set. Entries without a value (no source tree, property missing there,
+ * no EEPROM) are skipped, a node with no value left is not touched.
+ */
+
+#include <fdt_support.h>
+#include <stdio.h>
+#include <linux/errno.h>
+#include <linux/libfdt.h>
+#include <linux/string.h>
+
+#include "unipi_system.h"
+
+#define FDTFIX_MAX		32
+#define FDTFIX_STRBUF		128
+
+struct fdtfix_val {
+	const void *val;
+	int len;
+};
+
+/* space of one property, the name may be new in the strings block */
+static int fdtfix_prop_space(const char *name, int len)
+{
+	return sizeof(struct fdt_property) + FDT_TAGALIGN(len) +
+	       strlen(name) + 1;
+}
+
+/* space of a node added under an existing one: begin/end tag and name */
+static int fdtfix_node_space(const char *path)
+{
+	const char *name = strrchr(path, '/') + 1;
+
+	return 2 * FDT_TAGSIZE + FDT_TAGALIGN(strlen(name) + 1);
+}
+
+static int fdtfix_free_space(void *blob)
+{
+	return fdt_totalsize(blob) - fdt_off_dt_strings(blob) -
+	       fdt_size_dt_strings(blob);
+}
+
+/* value of one entry, strings for EEPROM values are kept in strbuf */
+static int fdtfix_resolve(const struct unipi_fdtfix_prop *prop,
+			  const void *src, int srcnode, char *strbuf,
+			  int *strpos, struct fdtfix_val *v)
+{
+	char *buf = strbuf + *strpos;
+	int size = FDTFIX_STRBUF - *strpos;
+
+	switch (prop->op) {
+	case UNIPI_FDTFIX_COPY:
+		if (!src || srcnode < 0)
+			return -ENOENT;
+		v->val = fdt_getprop(src, srcnode, prop->name, &v->len);
+		return v->val ? 0 : -ENOENT;
+	case UNIPI_FDTFIX_STR:
+		v->val = prop->get ? prop->get() : prop->str;
+		if (!v->val)
+			return -ENOENT;
+		break;
+	case UNIPI_FDTFIX_EEPROM:
+		if (size <= 1 || unipi_eeprom_string(prop->ee, buf, size))
+			return -ENOENT;
+		v->val = buf;
+		*strpos += strlen(buf) + 1;
+		break;
+	default:
+		return -EINVAL;
+	}
+	v->len = strlen(v->val);
+	if (!(prop->flags & UNIPI_FDTFIX_PROP_NONUL))
+		v->len++;
+	return 0;
+}
+
+static int fdtfix_node_offset(void *blob, const struct unipi_fdtfix_node *node)
+{
+	const char *name = strrchr(node->path, '/') + 1;
+	int parent;
+
+	if (!(node->flags & UNIPI_FDTFIX_NODE_CREATE) || !*name)
+		return fdt_path_offset(blob, node->path);
+	parent = name - node->path > 1 ?
+		 fdt_path_offset_namelen(blob, node->path,
+					 name - node->path - 1) : 0;
+	if (parent < 0)
+		return parent;
+	return fdt_find_or_add_subnode(blob, parent, name);
+}
+
+/*
+ * Apply the fixup table to blob. src is the tree for the copy entries,
+ * NULL (or blob itself) skips them. Errors are printed and the boot goes
+ * on without the fixups, like a failed fdt_setprop() in board code always
+ * did. Returns 0.
+ */
+int unipi_fdt_fixup(void *blob, const void *src,
+		    const struct unipi_fdtfix_node *nodes, int count)
+{
+	struct fdtfix_val vals[FDTFIX_MAX];
+	char strbuf[FDTFIX_STRBUF];
+	int strpos = 0, need = 0, n = 0;
+	int i, j, first, off, ret;
+
+	/* copied values point into src, it must not move */
+	if (src == blob)
+		src = NULL;
+
+	/* resolve the values and the space needed */
+	for (i = 0; i < count; i++) {
+		const struct unipi_fdtfix_node *node = &nodes[i];
+		int srcnode = src ? fdt_path_offset(src, node->path) : -ENOENT;
+		bool used = false;
+
+		for (j = 0; j < node->count; j++, n++) {
+			if (n == FDTFIX_MAX) {
+				printf("FDT fixup: more than %d entries\n",
+				       FDTFIX_MAX);
+				return 0;
+			}
+			vals[n].val = NULL;
+			if (fdtfix_resolve(&node->props[j], src, srcnode,
+					   strbuf, &strpos, &vals[n]))
+				continue;
+			need += fdtfix_prop_space(node->props[j].name,
+						  vals[n].len);
+			used = true;
+		}
+		if (used && (node->flags & UNIPI_FDTFIX_NODE_CREATE))
+			need += fdtfix_node_space(node->path);
+	}
+
+	if (need > fdtfix_free_space(blob)) {
+		ret = fdt_increase_size(blob, need - fdtfix_free_space(blob));
+		if (ret) {
+			printf("FDT fixup: %s\n", fdt_strerror(ret));
+			return 0;
+		}
+	}
+
+	/* one lookup per node in the destination tree */
+	for (i = 0, first = 0; i < count; first += nodes[i++].count) {
+		const struct unipi_fdtfix_node *node = &nodes[i];
+
+		for (j = 0; j < node->count && !vals[first + j].val; j++)
+			;
+		if (j == node->count)
+			continue;
+		off = fdtfix_node_offset(blob, node);
+		if (off < 0) {
+			printf("FDT fixup %s: %s\n", node->path,
+			       fdt_strerror(off));
+			continue;
+		}
+		for (; j < node->count; j++) {
+			const struct fdtfix_val *v = &vals[first + j];
+
+			if (!v->val)
+				continue;
+			ret = fdt_setprop(blob, off, node->props[j].name,
+					  v->val, v->len);
+			if (ret)
+				printf("FDT fixup %s/%s: %s\n", node->path,
+				       node->props[j].name, fdt_strerror(ret));
+		}
+	}
+	return 0;
+}
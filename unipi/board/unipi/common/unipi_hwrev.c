@@ -0,0 +1,203 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * Hardware revision check of boot directories
+ *
+ * File hwrevision.compatible in the boot directory lists hardware revisions
+ * the OS image supports, one board per line followed by its revisions:
+ *
+ *   # comment
+ *   zulu 1.0 2.0
+ *   g1 2.0
+ *
+ * The revision of the running board ("zulu 2.0") must be listed. A file
+ * without such lines (existing images ship it empty, as a marker) accepts
+ * any revision. Images without the file are accepted only on boards which
+ * don't require it (first hardware revisions). The verdict is remembered
+ * per partition and prefix until the next bootflow scan starts.
+ */
+
+#include <blk.h>
+#include <bootflow.h>
+#include <bootmeth.h>
+#include <fs.h>
+#include <log.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <linux/ctype.h>
+#include <linux/errno.h>
+#include <linux/string.h>
+
+#include "unipi_system.h"
+
+#define HWREV_FNAME		"hwrevision.compatible"
+#define HWREV_MAX_SIZE		1024
+#define HWREV_CACHE_MAX		16
+#define HWREV_PREFIX_LEN	16
+
+struct hwrev_ent {
+	struct blk_desc *desc;
+	int part;
+	char prefix[HWREV_PREFIX_LEN];
+	int ret;
+};
+
+static struct hwrev_ent hwrev_cache[HWREV_CACHE_MAX];
+static int hwrev_count;
+
+/* called from bootmeth_file_cache_reset() */
+void unipi_hwrev_reset(void)
+{
+	hwrev_count = 0;
+}
+
+static struct hwrev_ent *hwrev_find(struct blk_desc *desc, int part,
+				    const char *prefix)
+{
+	int i;
+
+	for (i = 0; i < hwrev_count; i++) {
+		if (hwrev_cache[i].desc == desc && hwrev_cache[i].part == part &&
+		    !strcmp(hwrev_cache[i].prefix, prefix))
+			return &hwrev_cache[i];
+	}
+	return NULL;
+}
+
+static void hwrev_remember(struct blk_desc *desc, int part,
+			   const char *prefix, int ret)
+{
+	struct hwrev_ent *ent;
+
+	if (hwrev_count >= HWREV_CACHE_MAX ||
+	    strlen(prefix) >= HWREV_PREFIX_LEN)
+		return;
+	ent = &hwrev_cache[hwrev_count++];
+	ent->desc = desc;
+	ent->part = part;
+	strlcpy(ent->prefix, prefix, sizeof(ent->prefix));
+	ent->ret = ret;
+}
+
+static char *hwrev_token(char **s)
+{
+	char *tok;
+
+	while (**s == ' ' || **s == '\t')
+		(*s)++;
+	tok = *s;
+	while (**s && !isspace(**s))
+		(*s)++;
+	if (**s)
+		*(*s)++ = '\0';
+	return *tok ? tok : NULL;
+}
+
+/*
+ * hwrev is "<board> <revision>". Without any "<board> <rev>..." line the
+ * file is a plain marker and matches every revision.
+ */
+static bool hwrev_match(char *list, const char *hwrev)
+{
+	const char *rev = strchr(hwrev, ' ');
+	char *line, *board, *tok;
+	bool listed = false;
+	int len;
+
+	if (!rev)
+		return false;
+	len = rev++ - hwrev;
+
+	while ((line = strsep(&list, "\n"))) {
+		if (*line == '#')
+			continue;
+		board = hwrev_token(&line);
+		tok = board ? hwrev_token(&line) : NULL;
+		if (!tok)
+			continue;
+		listed = true;
+		if (strlen(board) != len || strncmp(board, hwrev, len))
+			continue;
+		for (; tok; tok = hwrev_token(&line)) {
+			if (!strcmp(tok, rev))
+				return true;
+		}
+	}
+	return !listed;
+}
+
+static int hwrev_read(struct bootflow *bflow, struct blk_desc *desc,
+		      const char *prefix, const char *hwrev)
+{
+	loff_t len;
+	char *buf;
+	int ret;
+
+	if (!bflow->size)
+		return 0;
+	if (bflow->size > HWREV_MAX_SIZE)
+		return -E2BIG;
+
+	buf = malloc(bflow->size + 1);
+	if (!buf)
+		return -ENOMEM;
+	ret = fs_read(bflow->fname, map_to_sysmem(buf), 0, bflow->size, &len);
+	if (!ret) {
+		buf[len] = '\0';
+		if (!hwrev_match(buf, hwrev)) {
+			printf("%s%s: %s not listed, skipping\n",
+			       prefix, HWREV_FNAME, hwrev);
+			ret = -EPERM;
+		}
+	}
+	free(buf);
+
+	/* fs_read() closed the filesystem, the bootmeth tries more files */
+	if (bootmeth_setup_fs(bflow, desc) && !ret)
+		ret = -EIO;
+	return ret;
+}
+
+static int hwrev_check(struct bootflow *bflow, struct blk_desc *desc,
+		       const char *prefix, const char *hwrev, bool need_file)
+{
+	enum bootflow_state_t state = bflow->state;
+	int ret;
+
+	ret = bootmeth_try_file(bflow, desc, prefix, HWREV_FNAME);
+	if (ret)
+		ret = need_file ? ret : 0;
+	else
+		ret = hwrev_read(bflow, desc, prefix, hwrev);
+
+	/* the bootflow doesn't describe this file */
+	free(bflow->fname);
+	bflow->fname = NULL;
+	bflow->size = 0;
+	bflow->state = state;
+	return ret;
+}
+
+/* called from bootmeth_verify_dir() of the board */
+int unipi_hwrev_verify(struct bootflow *bflow, struct blk_desc *desc,
+		       const char *prefix, const char *hwrev, bool need_file)
+{
+	struct hwrev_ent *ent;
+	int ret;
+
+	if (!prefix)
+		prefix = "";
+	ent = hwrev_find(desc, bflow->part, prefix);
+	if (ent)
+		return ent->ret;
+
+	ret = hwrev_check(bflow, desc, prefix, hwrev, need_file);
+	hwrev_remember(desc, bflow->part, prefix, ret);
+	return ret;
+}
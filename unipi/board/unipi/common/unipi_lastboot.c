@@ -0,0 +1,269 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * Last known bootflow
+ *
+ * Before the OS is started, device, partition, prefix and bootmeth of the
+ * bootflow are stored into RTC SRAM. On the next power-up 'lastboot boot'
+ * scans only this one bootflow. If it is missing or returns, the record is
+ * erased and bootcmd continues with the full 'bootflow scan'.
+ *
+ * The record is used only if the OS confirmed the boot by resetting
+ * bootcount (bootcount is 1 after the increment). A kernel which doesn't
+ * come up is not tried first again, its record is erased.
+ */
+
+#include <bootflow.h>
+#include <bootmeth.h>
+#include <bootstd.h>
+#include <command.h>
+#include <dm.h>
+#include <env.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <u-boot/crc.h>
+#include <linux/errno.h>
+
+#include "unipi_system.h"
+
+#define LASTBOOT_MAGIC		0xb5
+#define LASTBOOT_NO_PREFIX	0xff
+
+struct lastboot_rec {
+	u8 magic;
+	u8 devnum;
+	u8 part;
+	u8 prefix;
+	char method[11];
+	u8 crc;
+} __packed;
+
+static int lastboot_load(struct lastboot_rec *rec)
+{
+	int ret;
+
+	ret = unipi_rtcram_read(UNIPI_RTCRAM_LASTBOOT, (u8 *)rec, sizeof(*rec));
+	if (ret)
+		return ret;
+	if (rec->magic != LASTBOOT_MAGIC)
+		return -ENOENT;
+	if (crc8(0, (u8 *)rec, sizeof(*rec) - 1) != rec->crc)
+		return -EBADMSG;
+	rec->method[sizeof(rec->method) - 1] = '\0';
+	return 0;
+}
+
+/* altbootcmd is running or A/B slots are used, leave the decision to them */
+static bool lastboot_inhibited(void)
+{
+	ulong bootlimit = env_get_ulong("bootlimit", 10, 0);
+
+	if (IS_ENABLED(CONFIG_UNIPI_ABSLOT) && unipi_abslot_active())
+		return true;
+	return bootlimit && env_get_ulong("bootcount", 10, 0) > bootlimit;
+}
+
+/* the OS didn't reset bootcount, the last boot wasn't confirmed */
+static bool lastboot_unconfirmed(void)
+{
+	return IS_ENABLED(CONFIG_BOOTCOUNT_LIMIT) &&
+	       env_get_ulong("bootcount", 10, 0) > 1;
+}
+
+/* Return mmc device, partition, prefix and bootmeth of the remembered bootflow */
+int unipi_lastboot_get(int *devnum, int *part, const char **prefix,
+		       char *method, int size)
+{
+	struct bootstd_priv *std;
+	struct lastboot_rec rec;
+	int i, ret;
+
+	if (lastboot_inhibited())
+		return -EBUSY;
+	if (lastboot_unconfirmed())
+		return -ESTALE;
+	ret = lastboot_load(&rec);
+	if (ret)
+		return ret;
+
+	*devnum = rec.devnum;
+	*part = rec.part;
+	strlcpy(method, rec.method, size);
+	*prefix = NULL;
+	if (rec.prefix != LASTBOOT_NO_PREFIX && !bootstd_get_priv(&std) &&
+	    std->prefixes) {
+		for (i = 0; std->prefixes[i] && i < rec.prefix; i++)
+			;
+		*prefix = std->prefixes[i];
+	}
+	return 0;
+}
+
+static void lastboot_clear(void)
+{
+	struct lastboot_rec rec;
+
+	memset(&rec, 0, sizeof(rec));
+	unipi_rtcram_write(UNIPI_RTCRAM_LASTBOOT, (u8 *)&rec, sizeof(rec));
+}
+
+static int lastboot_prefix_index(const char *subdir)
+{
+	struct bootstd_priv *std;
+	int i;
+
+	if (bootstd_get_priv(&std) || !std->prefixes || !subdir)
+		return LASTBOOT_NO_PREFIX;
+	for (i = 0; std->prefixes[i] && i < LASTBOOT_NO_PREFIX; i++) {
+		if (!strcmp(std->prefixes[i], subdir))
+			return i;
+	}
+	return LASTBOOT_NO_PREFIX;
+}
+
+void unipi_lastboot_store(struct bootflow *bflow)
+{
+	struct lastboot_rec rec, old;
+	struct udevice *media;
+	bool trial;
+
+	if (!bflow->dev || !bflow->method)
+		return;
+	media = dev_get_parent(bflow->dev);
+
+	/*
+	 * tryboot marks its target and sets bootcount to 0 before booting
+	 * it; a mark without that (saved by a script) is stale
+	 */
+	trial = env_get("tryboot_label");
+	if (trial && env_get_ulong("bootcount", 10, 0)) {
+		env_set("tryboot_label", NULL);
+		trial = false;
+	}
+
+	/* Only mmc bootflows are remembered; one-shot bootmeths never */
+	if (device_get_uclass_id(media) != UCLASS_MMC ||
+	    !strcmp(bflow->method->name, "altboot") ||
+	    !strcmp(bflow->method->name, "tryboot") || trial ||
+	    strlen(bflow->method->name) >= sizeof(rec.method)) {
+		if (lastboot_load(&old) == 0)
+			lastboot_clear();
+		return;
+	}
+
+	memset(&rec, 0, sizeof(rec));
+	rec.magic = LASTBOOT_MAGIC;
+	rec.devnum = dev_seq(media);
+	rec.part = bflow->part;
+	rec.prefix = lastboot_prefix_index(bflow->subdir);
+	strlcpy(rec.method, bflow->method->name, sizeof(rec.method));
+	rec.crc = crc8(0, (u8 *)&rec, sizeof(rec) - 1);
+
+	/* Don't rewrite RTC if the winner is the same as last time */
+	if (lastboot_load(&old) == 0 && !memcmp(&old, &rec, sizeof(rec)))
+		return;
+	unipi_rtcram_write(UNIPI_RTCRAM_LASTBOOT, (u8 *)&rec, sizeof(rec));
+}
+
+static int lastboot_boot(void)
+{
+	struct bootstd_priv *std;
+	const char **old_prefixes;
+	const char *prefixes[2] = { NULL, NULL };
+	struct udevice **old_order = NULL;
+	struct lastboot_rec rec;
+	int ret, i, old_count;
+
+	if (lastboot_inhibited())
+		return -EBUSY;
+
+	ret = lastboot_load(&rec);
+	if (ret)
+		return ret;
+	if (lastboot_unconfirmed()) {
+		printf("LASTBOOT: last boot not confirmed, record dropped\n");
+		lastboot_clear();
+		return -ESTALE;
+	}
+	ret = bootstd_get_priv(&std);
+	if (ret)
+		return ret;
+
+	/* bootmeth_set_order() frees current order, keep a copy of it */
+	old_count = std->bootmeth_count;
+	if (std->bootmeth_order) {
+		old_order = memdup(std->bootmeth_order,
+				   old_count * sizeof(struct udevice *));
+		if (!old_order)
+			return -ENOMEM;
+	}
+
+	old_prefixes = std->prefixes;
+	if (rec.prefix != LASTBOOT_NO_PREFIX && old_prefixes) {
+		for (i = 0; old_prefixes[i] && i < rec.prefix; i++)
+			;
+		if (!old_prefixes[i]) {
+			free(old_order);
+			lastboot_clear();
+			return -ENOENT;
+		}
+		prefixes[0] = old_prefixes[i];
+		std->prefixes = prefixes;
+	}
+
+	ret = bootmeth_set_order(rec.method);
+	if (ret == 0) {
+		printf("LASTBOOT: mmc%u:%u %s%s\n", rec.devnum, rec.part,
+		       rec.method, prefixes[0] ? prefixes[0] : "");
+		run_commandf("bootflow scan -b mmc%u:%u", rec.devnum, rec.part);
+		/* the full scan which follows can reuse the misses */
+		if (IS_ENABLED(CONFIG_UNIPI_NEGCACHE))
+			unipi_negcache_keep();
+	}
+
+	/* Still here - the remembered bootflow is gone or failed */
+	std->prefixes = old_prefixes;
+	free(std->bootmeth_order);
+	std->bootmeth_order = old_order;
+	std->bootmeth_count = old_count;
+	lastboot_clear();
+	return -ENOENT;
+}
+
+static int do_lastboot(struct cmd_tbl *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	struct lastboot_rec rec;
+
+	if (argc != 2)
+		return CMD_RET_USAGE;
+
+	if (!strcmp(argv[1], "boot")) {
+		return lastboot_boot() ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+	} else if (!strcmp(argv[1], "clear")) {
+		lastboot_clear();
+	} else if (!strcmp(argv[1], "info")) {
+		if (lastboot_load(&rec)) {
+			printf("No last bootflow stored\n");
+			return CMD_RET_FAILURE;
+		}
+		printf("mmc%u:%u bootmeth %s prefix %d\n", rec.devnum, rec.part,
+		       rec.method, rec.prefix == LASTBOOT_NO_PREFIX ? -1 : rec.prefix);
+	} else {
+		return CMD_RET_USAGE;
+	}
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(lastboot, 2, 0, do_lastboot,
+	   "boot the last started bootflow",
+	   "boot  - scan only the remembered bootflow\n"
+	   "lastboot clear - forget the remembered bootflow\n"
+	   "lastboot info  - show the remembered bootflow"
+);
@@ -0,0 +1,80 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * Negative lookup cache for bootmeths
+ *
+ * Bootmeths try many files (boot.scr.uimg, boot.scr, tryboot, recover.scr,
+ * hwrevision.compatible) in several prefixes on every partition. Each miss
+ * costs a filesystem mount and a directory walk. Files which were not found
+ * are remembered per partition until the next bootflow scan starts, so the
+ * next bootmeth asking for the same path doesn't touch the filesystem.
+ * Scans nested in a boot (tryboot, abslot) and the scan following a failed
+ * lastboot keep the entries.
+ */
+
+#include <blk.h>
+#include <bootmeth.h>
+#include <linux/string.h>
+
+#include "unipi_system.h"
+
+#define NEGCACHE_MAX		32
+#define NEGCACHE_PATH_LEN	64
+
+struct negcache_ent {
+	struct blk_desc *desc;
+	int part;
+	char path[NEGCACHE_PATH_LEN];
+};
+
+static struct negcache_ent negcache[NEGCACHE_MAX];
+static int negcache_count;
+static bool negcache_keep;
+
+/* called from bootmeth_file_cache_reset(), files may have changed since */
+void unipi_negcache_reset(void)
+{
+	if (negcache_keep)
+		negcache_keep = false;
+	else
+		negcache_count = 0;
+}
+
+/* the next scan continues the one which just ended (lastboot, bootcmd) */
+void unipi_negcache_keep(void)
+{
+	negcache_keep = true;
+}
+
+/* called from bootmeth_try_file() before the filesystem is mounted */
+bool bootmeth_file_known_missing(struct blk_desc *desc, int part,
+				 const char *path)
+{
+	int i;
+
+	for (i = 0; i < negcache_count; i++) {
+		if (negcache[i].desc == desc && negcache[i].part == part &&
+		    !strcmp(negcache[i].path, path))
+			return true;
+	}
+	return false;
+}
+
+/* called from bootmeth_try_file() when the file was not found */
+void bootmeth_file_missing(struct blk_desc *desc, int part, const char *path)
+{
+	struct negcache_ent *ent;
+
+	if (negcache_count >= NEGCACHE_MAX || strlen(path) >= NEGCACHE_PATH_LEN)
+		return;
+	ent = &negcache[negcache_count++];
+	ent->desc = desc;
+	ent->part = part;
+	strlcpy(ent->path, path, sizeof(ent->path));
+}
@@ -0,0 +1,158 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * Ethernet PHY helpers
+ *
+ * PHYs are registered from board_phy_config().
+ *
+ * Cheap link presence check for network bootdevs: before dhcp/pxe bootmeths
+ * start the interface (and wait CONFIG_PHY_ANEG_TIMEOUT for autoneg), BMSR
+ * of the PHY is checked. Link which doesn't come up within settle time
+ * after PHY reset means no cable, and the bootdev is skipped. On boards
+ * with two ports (G1) the PHYs race, the bootdev of the port which gets
+ * link first runs dhcp. If that was the bootdev of the other port, the
+ * bootdev of the winner is skipped afterwards, dhcp already ran there.
+ *
+ * Edge is not covered: bcmgenet connects its PHY only when the interface
+ * is started, there is no PHY to check before.
+ */
+
+#include <dm.h>
+#include <env.h>
+#include <log.h>
+#include <net.h>
+#include <phy.h>
+#include <time.h>
+#include <linux/delay.h>
+#include <linux/errno.h>
+
+#include "unipi_system.h"
+
+#define UNIPI_MAX_PHY	2
+
+/* one slot per Ethernet device, a reconnected PHY replaces the old one */
+struct unipi_phy {
+	struct udevice *eth;
+	struct phy_device *phydev;
+	ulong reset_time;
+};
+
+static struct unipi_phy unipi_phys[UNIPI_MAX_PHY];
+
+/* called from board_phy_config(), PHY was just reset by phy_connect() */
+void unipi_phy_register(struct phy_device *phydev)
+{
+	struct unipi_phy *uphy = NULL;
+	int i;
+
+	for (i = 0; i < UNIPI_MAX_PHY; i++) {
+		if (unipi_phys[i].eth == phydev->dev) {
+			uphy = &unipi_phys[i];
+			break;
+		}
+		if (!uphy && !unipi_phys[i].eth)
+			uphy = &unipi_phys[i];
+	}
+	if (!uphy)
+		return;
+	uphy->eth = phydev->dev;
+	uphy->phydev = phydev;
+	uphy->reset_time = get_timer(0);
+}
+
+#if IS_ENABLED(CONFIG_UNIPI_NET_LINK_CHECK)
+/* port picked by the race on behalf of the bootdev of another port */
+static struct udevice *unipi_net_raced;
+
+static struct unipi_phy *unipi_phy_find(struct udevice *eth)
+{
+	int i;
+
+	for (i = 0; i < UNIPI_MAX_PHY; i++) {
+		if (unipi_phys[i].phydev && unipi_phys[i].eth == eth)
+			return &unipi_phys[i];
+	}
+	return NULL;
+}
+
+static bool unipi_phy_link(struct phy_device *phydev)
+{
+	int bmsr;
+
+	/* link status is latched low, read twice */
+	phy_read(phydev, MDIO_DEVAD_NONE, MII_BMSR);
+	bmsr = phy_read(phydev, MDIO_DEVAD_NONE, MII_BMSR);
+
+	return bmsr >= 0 && (bmsr & BMSR_LSTATUS);
+}
+
+/* another port got link first */
+static struct unipi_phy *unipi_phy_other_link(struct unipi_phy *uphy)
+{
+	int i;
+
+	for (i = 0; i < UNIPI_MAX_PHY; i++) {
+		if (unipi_phys[i].phydev && &unipi_phys[i] != uphy &&
+		    unipi_phy_link(unipi_phys[i].phydev))
+			return &unipi_phys[i];
+	}
+	return NULL;
+}
+
+/*
+ * called from eth_get_bootflow() before the interface is started
+ *
+ * All PHYs are polled together, the first port with link wins. dhcp runs
+ * on the current eth device, not on the device of the bootdev, so the
+ * winner is made current. The bootdev of the winner, iterated next, is
+ * skipped so dhcp doesn't run (and time out) on the same port twice.
+ */
+int eth_bootdev_check_link(struct udevice *dev)
+{
+	struct udevice *eth = dev_get_parent(dev);
+	struct unipi_phy *uphy, *other;
+	ulong deadline;
+
+	if (unipi_net_raced == eth) {
+		unipi_net_raced = NULL;
+		printf("%s: already used, skipping network boot\n", eth->name);
+		return -ESHUTDOWN;
+	}
+	unipi_net_raced = NULL;
+
+	if (device_probe(eth))
+		return 0;
+	uphy = unipi_phy_find(eth);
+	if (!uphy)
+		return 0;
+
+	deadline = uphy->reset_time + CONFIG_UNIPI_NET_LINK_SETTLE_MS;
+	while (!unipi_phy_link(uphy->phydev)) {
+		other = unipi_phy_other_link(uphy);
+		if (other) {
+			eth = other->eth;
+			unipi_net_raced = eth;
+			printf("%s: no link, using %s\n",
+			       dev_get_parent(dev)->name, eth->name);
+			break;
+		}
+		if (get_timer(0) > deadline) {
+			printf("%s: no link, skipping network boot\n",
+			       eth->name);
+			/* move the iterator to the next bootdev */
+			return -ESHUTDOWN;
+		}
+		mdelay(50);
+	}
+
+	if (eth_get_dev() != eth)
+		env_set("ethact", eth->name);
+	return 0;
+}
+#endif
@@ -0,0 +1,84 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * Partition table cache
+ *
+ * Every part_get_info() reads and checks the partition table again (GPT
+ * header, 32 sectors of entries and two CRCs). Bootdev iteration, every
+ * bootmeth, fstype in scripts and mmc0:N labels ask for the same
+ * partitions many times during one boot. Results (including "no such
+ * partition") are kept per block device and hardware partition, eMMC
+ * user area and boot partitions share one blk_desc. Any write to the
+ * device and part_init() (new medium) drop its entries.
+ */
+
+#include <blk.h>
+#include <part.h>
+#include <linux/string.h>
+
+#include "unipi_system.h"
+
+#define PARTCACHE_MAX	32
+
+struct partcache_ent {
+	struct blk_desc *desc;
+	int hwpart;
+	int part;
+	int ret;
+	struct disk_partition info;
+};
+
+static struct partcache_ent partcache[PARTCACHE_MAX];
+static int partcache_next;
+
+/* called from part_get_info_by_type() before the table is read */
+bool part_cache_lookup(struct blk_desc *desc, int part,
+		       struct disk_partition *info, int *ret)
+{
+	int i;
+
+	for (i = 0; i < PARTCACHE_MAX; i++) {
+		if (partcache[i].desc == desc &&
+		    partcache[i].hwpart == desc->hwpart &&
+		    partcache[i].part == part) {
+			*ret = partcache[i].ret;
+			if (!*ret)
+				*info = partcache[i].info;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* called from part_get_info_by_type() with the result of the driver */
+void part_cache_store(struct blk_desc *desc, int part,
+		      struct disk_partition *info, int ret)
+{
+	struct partcache_ent *ent = &partcache[partcache_next];
+
+	/* round robin, the whole table of one device fits */
+	partcache_next = (partcache_next + 1) % PARTCACHE_MAX;
+	ent->desc = desc;
+	ent->hwpart = desc->hwpart;
+	ent->part = part;
+	ent->ret = ret;
+	if (!ret)
+		ent->info = *info;
+}
+
+/* called from part_cache_invalidate() */
+void unipi_partcache_invalidate(struct blk_desc *desc)
+{
+	int i;
+
+	for (i = 0; i < PARTCACHE_MAX; i++) {
+		if (partcache[i].desc == desc)
+			partcache[i].desc = NULL;
+	}
+}
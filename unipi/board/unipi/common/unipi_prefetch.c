@@ -0,0 +1,297 @@
+/*
+ *
+ * Copyright (c) 2026  Unipi Technology, ondra@unipi.technology
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ *
+ */
+
+/*
+ * Prefetch boot images during autoboot countdown
+ *
+ * If the remembered bootflow (see unipi_lastboot.c) was started by bootmeth
+ * 'unipi', the kernel, ramdisk and fdt of its unipi.conf are prefetched to
+ * kernel_addr_r, ramdisk_addr_r and fdt_addr_r. Variable prefetch_files
+ * overrides this and is needed for scripts, a list of "addr_var:file"
+ * pairs, e.g.
+ *   prefetch_files=kernel_addr_r:vmlinuz fdt_addr_r:unipi-zulu.dtb
+ * Relative file names are prefixed with the prefix of the remembered
+ * bootflow. Files are loaded from that partition
+ * while the countdown is running, in chunks. The console is polled between
+ * the chunks and prefetching stops on a key or at the end of the countdown,
+ * the unfinished file is loaded by the script as usual. Nothing is used if
+ * the countdown is interrupted. Otherwise the first 'load' of the same file
+ * to the same address in the boot script is served from memory.
+ *
+ * Any other file read or network transfer into a prefetched image drops it.
+ */
+
+#include <env.h>
+#include <fs.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <stdio.h>
+#include <time.h>
+#include <vsprintf.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
+
+#include "unipi_system.h"
+
+#define PREFETCH_MAX		4
+#define PREFETCH_PATH_LEN	128
+#define PREFETCH_CHUNK		SZ_2M
+#define PREFETCH_CONF		"unipi.conf"
+#define PREFETCH_CONF_MAX	0x1000
+#define PREFETCH_LIST_LEN	256
+
+struct prefetch_ent {
+	int devnum;
+	int part;
+	ulong addr;
+	loff_t size;
+	char path[PREFETCH_PATH_LEN];
+};
+
+static struct prefetch_ent prefetched[PREFETCH_MAX];
+static int prefetch_count;
+static bool prefetch_committed;
+
+/* copy path and squash repeated slashes ("${prefix}/${kernel}") */
+static void prefetch_path(char *dst, const char *prefix, const char *name)
+{
+	char tmp[PREFETCH_PATH_LEN];
+	char *d = dst;
+	const char *s;
+
+	if (name[0] != '/' && prefix)
+		snprintf(tmp, sizeof(tmp), "%s/%s", prefix, name);
+	else
+		snprintf(tmp, sizeof(tmp), "/%s", name);
+
+	for (s = tmp; *s; s++) {
+		if (*s == '/' && d > dst && d[-1] == '/')
+			continue;
+		*d++ = *s;
+	}
+	*d = '\0';
+}
+
+static int prefetch_parse_dev(const char *ifname, const char *dev_part_str,
+			      int *devnum, int *part)
+{
+	char *ep;
+
+	if (!ifname || strcmp(ifname, "mmc") || !dev_part_str)
+		return -ENOENT;
+	*devnum = simple_strtoul(dev_part_str, &ep, 16);
+	if (*ep != ':')
+		return -ENOENT;
+	*part = simple_strtoul(ep + 1, NULL, 16);
+	return 0;
+}
+
+/* every fs operation closes the filesystem */
+static int prefetch_open(int devnum, int part)
+{
+	char dev_part[16];
+
+	snprintf(dev_part, sizeof(dev_part), "%x:%x", devnum, part);
+	return fs_set_blk_dev("mmc", dev_part, FS_TYPE_ANY) ? -ENODEV : 0;
+}
+
+static int prefetch_one(int devnum, int part, const char *prefix,
+			const char *entry, u64 etime)
+{
+	struct prefetch_ent *ent = &prefetched[prefetch_count];
+	loff_t size, pos, len;
+	const char *colon;
+	char var[32];
+
+	colon = strchr(entry, ':');
+	if (!colon || colon - entry >= sizeof(var))
+		return -EINVAL;
+	strlcpy(var, entry, colon - entry + 1);
+
+	ent->addr = env_get_hex(var, 0);
+	if (!ent->addr)
+		return -EINVAL;
+	ent->devnum = devnum;
+	ent->part = part;
+	prefetch_path(ent->path, prefix, colon + 1);
+
+	if (prefetch_open(devnum, part))
+		return -ENODEV;
+	if (fs_size(ent->path, &size) || !size)
+		return -ENOENT;
+
+	/* keep the countdown responsive */
+	for (pos = 0; pos < size; pos += len) {
+		if (tstc() || get_ticks() > etime)
+			return -EINTR;
+		if (prefetch_open(devnum, part))
+			return -ENODEV;
+		if (fs_read(ent->path, ent->addr + pos, pos,
+			    min_t(loff_t, size - pos, PREFETCH_CHUNK), &len) ||
+		    !len)
+			return -EIO;
+	}
+
+	ent->size = size;
+	prefetch_count++;
+	return 0;
+}
+
+/*
+ * Files of a unipi.conf bootflow with the same defaults as bootmeth 'unipi':
+ * kernel, ramdisk and fdt (${unipi_fdt} or ${fdtfile}, not the firmware
+ * tree).
+ */
+static int prefetch_conf(int devnum, int part, const char *prefix,
+			 char *list, int size)
+{
+	static const char *const keys[] = { "kernel", "ramdisk", "fdt" };
+	static const char *const vars[] = {
+		"kernel_addr_r", "ramdisk_addr_r", "fdt_addr_r"
+	};
+	const char *val[ARRAY_SIZE(keys)] = { };
+	char path[PREFETCH_PATH_LEN], *buf, *line, *eq, *next;
+	loff_t fsize, len;
+	int i, pos = 0;
+
+	prefetch_path(path, prefix, PREFETCH_CONF);
+	if (prefetch_open(devnum, part) || fs_size(path, &fsize) ||
+	    fsize >= PREFETCH_CONF_MAX)
+		return -ENOENT;
+	buf = malloc(fsize + 1);
+	if (!buf)
+		return -ENOMEM;
+	if (prefetch_open(devnum, part) ||
+	    fs_read(path, map_to_sysmem(buf), 0, fsize, &len)) {
+		free(buf);
+		return -EIO;
+	}
+	buf[len] = '\0';
+
+	for (next = buf; (line = strsep(&next, "\n")); ) {
+		line = skip_spaces(line);
+		eq = strchr(line, '=');
+		if (*line == '#' || !eq)
+			continue;
+		*eq++ = '\0';
+		strim(line);
+		for (i = 0; i < ARRAY_SIZE(keys); i++) {
+			if (!strcmp(line, keys[i]))
+				val[i] = strim(eq);
+		}
+	}
+	if (!val[2])
+		val[2] = env_get("unipi_fdt");
+	if (!val[2])
+		val[2] = env_get("fdtfile");
+	if (val[2] && !strcmp(val[2], "firmware"))
+		val[2] = NULL;
+
+	list[0] = '\0';
+	for (i = 0; i < ARRAY_SIZE(keys); i++) {
+		if (val[i] && *val[i] && pos < size)
+			pos += snprintf(list + pos, size - pos, "%s:%s ",
+					vars[i], val[i]);
+	}
+	free(buf);
+	return pos < size ? 0 : -E2BIG;
+}
+
+/* called from abortboot_key_sequence() when countdown starts */
+void autoboot_prefetch_start(u64 etime)
+{
+	char list[PREFETCH_LIST_LEN], method[16], *entry, *next;
+	const char *files, *bootcmd, *prefix;
+	int devnum, part;
+
+	prefetch_count = 0;
+	prefetch_committed = false;
+
+	bootcmd = env_get("bootcmd");
+	if (!bootcmd || !strstr(bootcmd, "lastboot boot"))
+		return;
+	if (unipi_lastboot_get(&devnum, &part, &prefix, method,
+			       sizeof(method)))
+		return;
+
+	files = env_get("prefetch_files");
+	if (files)
+		strlcpy(list, files, sizeof(list));
+	else if (strcmp(method, "unipi") ||
+		 prefetch_conf(devnum, part, prefix, list, sizeof(list)))
+		return;
+	for (entry = list; entry && prefetch_count < PREFETCH_MAX; entry = next) {
+		next = strchr(entry, ' ');
+		if (next)
+			*next++ = '\0';
+		if (*entry == '\0')
+			continue;
+		if (prefetch_one(devnum, part, prefix, entry, etime))
+			break;
+	}
+}
+
+/* called from abortboot() when countdown finished */
+void autoboot_prefetch_end(int abort)
+{
+	if (abort)
+		prefetch_count = 0;
+	prefetch_committed = prefetch_count > 0;
+}
+
+/* called from do_load() before the file is read */
+int fs_load_prefetched(const char *ifname, const char *dev_part_str,
+		       const char *filename, ulong addr, loff_t pos,
+		       loff_t bytes, loff_t *len_read)
+{
+	char path[PREFETCH_PATH_LEN];
+	int devnum, part, i;
+
+	if (!prefetch_committed || pos || bytes)
+		return -ENOENT;
+	if (prefetch_parse_dev(ifname, dev_part_str, &devnum, &part))
+		return -ENOENT;
+
+	prefetch_path(path, NULL, filename);
+	for (i = 0; i < prefetch_count; i++) {
+		struct prefetch_ent *ent = &prefetched[i];
+
+		if (ent->addr != addr || ent->devnum != devnum ||
+		    ent->part != part || strcmp(ent->path, path))
+			continue;
+
+		/* serve only once, the image may be modified in place */
+		*len_read = ent->size;
+		ent->size = 0;
+		ent->addr = 0;
+		printf("(prefetched) ");
+		return 0;
+	}
+	return -ENOENT;
+}
+
+/*
+ * called from _fs_read() and net_loop(), drop overwritten images. len 0
+ * means the size isn't known, everything from addr on is dropped.
+ */
+void unipi_prefetch_drop(ulong addr, loff_t len)
+{
+	int i;
+
+	for (i = 0; i < prefetch_count; i++) {
+		struct prefetch_ent *ent = &prefetched[i];
+
+		if (addr < ent->addr + ent->size &&
+		    (!len || ent->addr < addr + len)) {
+			ent->size = 0;
+			ent->addr = 0;
+		}
+	}
+}
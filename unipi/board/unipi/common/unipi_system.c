@@ -6,10 +6,13 @@
  *
  */
 
+#include <bootflow.h>
 #include <dm/uclass.h>
 #include <env.h>
 #include <fdt_support.h>
 #include <i2c_eeprom.h>
+#include <linux/ctype.h>
+#include <linux/errno.h>
 #include <net-common.h>
 #include <rtc.h>
 #include <stdio.h>
@@ -27,6 +30,95 @@ int mac_read_from_eeprom(void);
 /* define weak functions - can be redifned in board file */
 __weak int check_button_status(int button_type) {return 0;}
 
+static struct udevice *unipi_get_rtc(void)
+{
+	struct udevice *dev;
+
+	if (uclass_get_device_by_name(UCLASS_RTC, "mcp7940x@6f", &dev) == 0)
+		return dev;
+	if (uclass_get_device_by_name(UCLASS_RTC, "rtc@6f", &dev) == 0)
+		return dev;
+	return NULL;
+}
+
+int unipi_rtcram_read(unsigned int reg, u8 *buf, unsigned int len)
+{
+	struct udevice *dev = unipi_get_rtc();
+
+	if (dev == NULL)
+		return -ENODEV;
+	if (reg + len > UNIPI_RTCRAM_END)
+		return -EINVAL;
+	return rtc_read(dev, reg, buf, len);
+}
+
+int unipi_rtcram_write(unsigned int reg, const u8 *buf, unsigned int len)
+{
+	struct udevice *dev = unipi_get_rtc();
+
+	if (dev == NULL)
+		return -ENODEV;
+	if (reg + len > UNIPI_RTCRAM_END)
+		return -EINVAL;
+	return rtc_write(dev, reg, buf, len);
+}
+
+int unipi_rtc_seconds(ulong *secs)
+{
+	struct udevice *dev = unipi_get_rtc();
+	struct rtc_time tm;
+
+	if (dev == NULL)
+		return -ENODEV;
+	if (dm_rtc_get(dev, &tm))
+		return -EIO;
+	*secs = rtc_mktime(&tm);
+	return 0;
+}
+
+#if IS_ENABLED(CONFIG_BOOTSTD)
+/* called from bootflow_boot() just before the bootmeth starts the OS */
+void bootflow_pre_boot(struct bootflow *bflow)
+{
+	if (IS_ENABLED(CONFIG_UNIPI_LASTBOOT))
+		unipi_lastboot_store(bflow);
+}
+
+/* called from bootflow_scan_first() unless nested, files may have changed */
+void bootmeth_file_cache_reset(void)
+{
+	if (IS_ENABLED(CONFIG_UNIPI_NEGCACHE))
+		unipi_negcache_reset();
+	unipi_hwrev_reset();
+}
+#endif
+
+#if IS_ENABLED(CONFIG_UNIPI_PARTCACHE) || \
+	IS_ENABLED(CONFIG_UNIPI_BOOTPART_FILTER)
+/* called from blk_write(), blk_erase() and part_init() */
+void part_cache_invalidate(struct blk_desc *desc)
+{
+	if (IS_ENABLED(CONFIG_UNIPI_PARTCACHE))
+		unipi_partcache_invalidate(desc);
+	if (IS_ENABLED(CONFIG_UNIPI_BOOTPART_FILTER))
+		unipi_bootpart_invalidate(desc);
+}
+#endif
+
+#if IS_ENABLED(CONFIG_UNIPI_PREFETCH)
+/* called from _fs_read() after every file read (load, bootmeths) */
+void fs_read_notify(ulong addr, loff_t len)
+{
+	unipi_prefetch_drop(addr, len);
+}
+
+/* called from net_loop(), the destination of a transfer isn't known */
+void net_loop_notify(void)
+{
+	unipi_prefetch_drop(0, 0);
+}
+#endif
+
 #if IS_ENABLED(CONFIG_ID_EEPROM)
 
 #define UNIPI_EEPROM_SIZE UNIEE_MIN_EE_SIZE
@@ -84,18 +176,14 @@ static void load_rtc_calibration(void)
 {
 	char calibration;
 	struct udevice *dev;
-	int ret;
 
 	if (get_unipi_eeprom() != 0)
 		return;
 	if (unipi_eeprom_get_bytes_property(unipi_eprom, uniee_descriptor, UNIEE_FIELD_TYPE_RTC, &calibration, 1) != 1)
 		return;
-	ret = uclass_get_device_by_name(UCLASS_RTC, "mcp7940x@6f", &dev);
-	if (ret != 0) {
-		ret = uclass_get_device_by_name(UCLASS_RTC, "rtc@6f", &dev);
-		if (ret != 0)
-			return;
-	}
+	dev = unipi_get_rtc();
+	if (dev == NULL)
+		return;
 	rtc_write8(dev, MCP794XX_REG_CALIBRATION, calibration);
 }
 
@@ -114,6 +202,27 @@ static void read_button(void)
 	}
 }
 
+/*
+ * Identity for the boot flow. unipi_overlays_default is unipi_<model>, the
+ * bootmeth 'unipi' may refine it by overlays/overlays.map of the image.
+ * It is derived on every boot, unipi_overlays is left to the user.
+ */
+static void load_model(void)
+{
+	char model[8], overlay[16];
+	int i;
+
+	unipi_eeprom_get_model(uniee_descriptor, model, sizeof(model));
+	if (!model[0])
+		return;
+	env_set("unipi_model", model);
+	env_set_ulong("unipi_sku", unipi_eeprom_get_sku(uniee_descriptor));
+	snprintf(overlay, sizeof(overlay), "unipi_%s", model);
+	for (i = 0; overlay[i]; i++)
+		overlay[i] = tolower(overlay[i]);
+	env_set("unipi_overlays_default", overlay);
+}
+
 int mac_read_from_eeprom(void)
 {
 	if (get_unipi_eeprom() != 0)
@@ -122,27 +231,31 @@ int mac_read_from_eeprom(void)
 	load_mac_address(0);
 	load_mac_address(1);
 	load_rtc_calibration();
+	load_model();
 
 	read_button();
 	return 0;
 }
 
-int ft_unipi_board_setup(void *blob, struct bd_info *bd)
+/* EEPROM value as a string for the fdt fixups */
+int unipi_eeprom_string(int val, char *buf, int size)
 {
-	char tmpstr[20];
 	if (get_unipi_eeprom() != 0)
-		return 0;
+		return -ENODEV;
 
-	if (snprintf(tmpstr, sizeof(tmpstr)-1, "%u", unipi_eeprom_get_serial(uniee_descriptor)) >= 0) {
-		tmpstr[sizeof(tmpstr)-1]= '\0';
-		fdt_setprop(blob, 0, "unipi-serial", tmpstr, strlen(tmpstr) + 1);
-	}
-	if (snprintf(tmpstr, sizeof(tmpstr)-1, "%u", unipi_eeprom_get_sku(uniee_descriptor)) >= 0) {
-		tmpstr[sizeof(tmpstr)-1]= '\0';
-		fdt_setprop(blob, 0, "unipi-sku", tmpstr, strlen(tmpstr) + 1);
+	switch (val) {
+	case UNIPI_EE_SERIAL:
+		snprintf(buf, size, "%u", unipi_eeprom_get_serial(uniee_descriptor));
+		break;
+	case UNIPI_EE_SKU:
+		snprintf(buf, size, "%u", unipi_eeprom_get_sku(uniee_descriptor));
+		break;
+	case UNIPI_EE_MODEL:
+		unipi_eeprom_get_model(uniee_descriptor, buf, size);
+		break;
+	default:
+		return -EINVAL;
 	}
-	unipi_eeprom_get_model(uniee_descriptor, tmpstr, sizeof(tmpstr));
-	fdt_setprop(blob, 0, "unipi-model", tmpstr, strlen(tmpstr) + 1);
 	return 0;
 }
 
@@ -152,8 +265,8 @@ int mac_read_from_eeprom(void)
 	return 0;
 }
 
-int ft_unipi_board_setup(void *blob, struct bd_info *bd)
+int unipi_eeprom_string(int val, char *buf, int size)
 {
-	return 0;
+	return -ENODEV;
 }
 #endif
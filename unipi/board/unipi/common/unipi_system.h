@@ -13,7 +13,127 @@
 #define htobe16(x) cpu_to_be16(x)
 #include "uniee.h"
 
-int ft_unipi_board_setup(void *blob, struct bd_info *bd);
+/*
+ * Battery backed SRAM of MCP7941x RTC (0x20 - 0x5f)
+ * 0x20-0x21 is used by bootcount-rtc driver (offset in DT)
+ */
+#define UNIPI_RTCRAM_LASTBOOT   0x22    /* 16 bytes */
+#define UNIPI_RTCRAM_DHCP       0x32    /* 11 bytes, 15 reserved */
+#define UNIPI_RTCRAM_ABSLOT     0x41    /* 5 bytes */
+#define UNIPI_RTCRAM_END        0x60
+
+struct udevice;
+struct bootflow;
+struct phy_device;
+struct in_addr;
+struct blk_desc;
+struct disk_partition;
+
 int check_button_status(int button_type);
+int unipi_rtcram_read(unsigned int reg, u8 *buf, unsigned int len);
+int unipi_rtcram_write(unsigned int reg, const u8 *buf, unsigned int len);
+int unipi_rtc_seconds(ulong *secs);
+void unipi_lastboot_store(struct bootflow *bflow);
+int unipi_lastboot_get(int *devnum, int *part, const char **prefix,
+		       char *method, int size);
+void unipi_phy_register(struct phy_device *phydev);
+bool unipi_abslot_active(void);
+void unipi_negcache_reset(void);
+void unipi_negcache_keep(void);
+void unipi_hwrev_reset(void);
+void unipi_bootpart_invalidate(struct blk_desc *desc);
+void unipi_partcache_invalidate(struct blk_desc *desc);
+int unipi_hwrev_verify(struct bootflow *bflow, struct blk_desc *desc,
+		       const char *prefix, const char *hwrev, bool need_file);
+
+/*
+ * Device tree fixups, a table per board. Properties are grouped by node,
+ * run by unipi_fdt_fixup() in order.
+ */
+enum unipi_fdtfix_op {
+	UNIPI_FDTFIX_COPY,	/* same node/property of the source tree */
+	UNIPI_FDTFIX_STR,	/* constant or computed string */
+	UNIPI_FDTFIX_EEPROM,	/* value from the board EEPROM, as string */
+};
+
+enum unipi_eeprom_val {
+	UNIPI_EE_SERIAL,
+	UNIPI_EE_SKU,
+	UNIPI_EE_MODEL,
+};
+
+/* flags of a property entry */
+enum unipi_fdtfix_prop_flags {
+	UNIPI_FDTFIX_PROP_NONUL = BIT(0),	/* value without the '\0' */
+};
+
+/* flags of a node entry */
+enum unipi_fdtfix_node_flags {
+	UNIPI_FDTFIX_NODE_CREATE = BIT(0),	/* created if missing */
+};
+
+struct unipi_fdtfix_prop {
+	u8 op;
+	u8 flags;
+	const char *name;
+	const char *str;
+	const char *(*get)(void);
+	u8 ee;
+};
+
+struct unipi_fdtfix_node {
+	const char *path;
+	u8 flags;
+	const struct unipi_fdtfix_prop *props;
+	int count;
+};
+
+#define FDTFIX_COPY(_name) \
+	{ .op = UNIPI_FDTFIX_COPY, .name = (_name) }
+#define FDTFIX_STR(_name, _str) \
+	{ .op = UNIPI_FDTFIX_STR, .name = (_name), .str = (_str) }
+#define FDTFIX_FUNC(_name, _get, _flags) \
+	{ .op = UNIPI_FDTFIX_STR, .flags = (_flags), .name = (_name), \
+	  .get = (_get) }
+#define FDTFIX_EEPROM(_name, _ee) \
+	{ .op = UNIPI_FDTFIX_EEPROM, .name = (_name), .ee = (_ee) }
+#define FDTFIX_NODE(_path, _flags, _props) \
+	{ .path = (_path), .flags = (_flags), .props = (_props), \
+	  .count = ARRAY_SIZE(_props) }
+
+/* identity of the board in the root node, common to all boards */
+#define UNIPI_FDTFIX_IDENTITY \
+	FDTFIX_EEPROM("unipi-serial", UNIPI_EE_SERIAL), \
+	FDTFIX_EEPROM("unipi-sku", UNIPI_EE_SKU), \
+	FDTFIX_EEPROM("unipi-model", UNIPI_EE_MODEL)
+
+int unipi_eeprom_string(int val, char *buf, int size);
+int unipi_fdt_fixup(void *blob, const void *src,
+		    const struct unipi_fdtfix_node *nodes, int count);
+
+/* hooks called from patched common/autoboot.c, fs/fs.c and net/net.c */
+void autoboot_prefetch_start(u64 etime);
+void autoboot_prefetch_end(int abort);
+void fs_read_notify(ulong addr, loff_t len);
+void net_loop_notify(void);
+int fs_load_prefetched(const char *ifname, const char *dev_part_str,
+		       const char *filename, ulong addr, loff_t pos,
+		       loff_t bytes, loff_t *len_read);
+void unipi_prefetch_drop(ulong addr, loff_t len);
+
+/* hook called from patched disk/part.c and drivers/block/blk-uclass.c */
+void part_cache_invalidate(struct blk_desc *desc);
+
+/* hook called from patched boot/bootdev-uclass.c */
+int bootdev_part_filter(struct blk_desc *desc, int part,
+			struct disk_partition *info);
+
+/* hook called from patched net/eth_bootdev.c */
+int eth_bootdev_check_link(struct udevice *dev);
+
+/* hooks called from patched net/bootp.c */
+int dhcp_lease_get(struct in_addr *ip);
+void dhcp_lease_store(struct in_addr ip, unsigned int lease_time);
+void dhcp_lease_drop(void);
 
 #endif /* __UNIPI_SYSTEM_H__*/
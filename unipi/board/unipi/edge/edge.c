@@ -6,8 +6,11 @@
 #include <config.h>
 #include <dm.h>
 #include <env.h>
+#include <event.h>
 #include <fdt_support.h>
 #include <memalign.h>
+#include <pci.h>
+#include <phy.h>
 #include <asm/io.h>
 #include <asm/gpio.h>
 #include <asm/global_data.h>
@@ -25,7 +28,6 @@ void rs485_tx_op(u32 *cr2, u32 *sr2, int op);
 void rs485_bcmtx_op(u32 *cr2, u32 *sr2, int op);
 int board_late_init(void);
 int ft_system_setup(void *blob, struct bd_info  *bd);
-int copy_property(void *dst, void *src, char *path, char *property);
 
 
 int rs485_enable = 0;
@@ -103,6 +105,33 @@ int check_button_status(int button_type)
 	return 1;
 }
 
+#if IS_ENABLED(CONFIG_UNIPI_EDGE_LAZY_PCI)
+/* VL805 xHCI sits behind PCIe, enumerate it before first USB probe */
+static int edge_usb_pre_probe(void *ctx, struct event *event)
+{
+	static bool pci_done;
+	struct udevice *dev = event->data.dm.dev;
+
+	if (pci_done || device_get_uclass_id(dev) != UCLASS_USB)
+		return 0;
+
+	pci_done = true;
+	pci_init();
+	return 0;
+}
+EVENT_SPY_FULL(EVT_DM_PRE_PROBE, edge_usb_pre_probe);
+#endif
+
+#if IS_ENABLED(CONFIG_UNIPI_NET_PHY)
+int board_phy_config(struct phy_device *phydev)
+{
+	if (phydev->drv->config)
+		phydev->drv->config(phydev);
+	unipi_phy_register(phydev);
+	return 0;
+}
+#endif
+
 int board_late_init(void)
 {
 #ifdef CONFIG_ENV_VARS_UBOOT_RUNTIME_CONFIG
@@ -112,24 +141,48 @@ int board_late_init(void)
     return 0;
 }
 
+static const struct unipi_fdtfix_prop edge_dma_props[] = {
+	FDTFIX_COPY("brcm,dma-channel-mask"),
+};
+
+static const struct unipi_fdtfix_prop edge_nvram_props[] = {
+	FDTFIX_COPY("status"),
+	FDTFIX_COPY("reg"),
+};
+
+static const struct unipi_fdtfix_prop edge_bootloader_props[] = {
+	FDTFIX_COPY("capabilities"),
+	FDTFIX_COPY("build-timestamp"),
+	FDTFIX_COPY("tryboot"),
+	FDTFIX_COPY("rsts"),
+	FDTFIX_COPY("update-timestamp"),
+	FDTFIX_COPY("version"),
+	FDTFIX_COPY("boot-mode"),
+	FDTFIX_COPY("partition"),
+};
+
+static const struct unipi_fdtfix_prop edge_root_props[] = {
+	UNIPI_FDTFIX_IDENTITY,
+};
+
+static const struct unipi_fdtfix_node edge_fdt_fixups[] = {
+	FDTFIX_NODE("/scb/dma@7e007b00", 0, edge_dma_props),
+	FDTFIX_NODE("/reserved-memory/nvram@1", 0, edge_nvram_props),
+	FDTFIX_NODE("/chosen/bootloader", UNIPI_FDTFIX_NODE_CREATE,
+		    edge_bootloader_props),
+	FDTFIX_NODE("/", 0, edge_root_props),
+};
+
 int ft_system_setup(void *blob, struct bd_info  *bd)
 {
-	if (blob != gd->fdt_blob) {
-		copy_property(blob, (void *)gd->fdt_blob, "/scb/dma@7e007b00", "brcm,dma-channel-mask");
-		copy_property(blob, (void *)gd->fdt_blob, "/reserved-memory/nvram@1", "status");
-		copy_property(blob, (void *)gd->fdt_blob, "/reserved-memory/nvram@1", "reg");
-		int nodeoff = fdt_path_offset(blob, "/chosen");
-		if (nodeoff >= 0) {
-			fdt_find_or_add_subnode(blob, nodeoff, "bootloader");
-			copy_property(blob, (void *)gd->fdt_blob, "/chosen/bootloader", "capabilities");
-			copy_property(blob, (void *)gd->fdt_blob, "/chosen/bootloader", "build-timestamp");
-			copy_property(blob, (void *)gd->fdt_blob, "/chosen/bootloader", "tryboot");
-			copy_property(blob, (void *)gd->fdt_blob, "/chosen/bootloader", "rsts");
-			copy_property(blob, (void *)gd->fdt_blob, "/chosen/bootloader", "update-timestamp");
-			copy_property(blob, (void *)gd->fdt_blob, "/chosen/bootloader", "version");
-			copy_property(blob, (void *)gd->fdt_blob, "/chosen/bootloader", "boot-mode");
-			copy_property(blob, (void *)gd->fdt_blob, "/chosen/bootloader", "partition");
-		}
-	}
-	return ft_unipi_board_setup(blob,bd);
+	const void *fw_blob = gd->fdt_blob;
+
+	/*
+	 * Tree loaded from disk gets the firmware properties. A copy of the
+	 * firmware tree (fdt=firmware in unipi.conf) carries them already.
+	 */
+	if (fdt_path_offset(blob, "/chosen/bootloader") >= 0)
+		fw_blob = NULL;
+	return unipi_fdt_fixup(blob, fw_blob, edge_fdt_fixups,
+			       ARRAY_SIZE(edge_fdt_fixups));
 }
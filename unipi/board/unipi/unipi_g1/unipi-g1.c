@@ -28,6 +28,7 @@
 #include <bloblist.h>
 #include <rtc.h>
 #include <bootmeth.h>
+#include <phy.h>
 
 #include "../common/uniee_values.h"
 #include "../common/unipi_system.h"
@@ -180,31 +181,45 @@ int check_button_status(int button_type)
 }
 
 
+static const char *g1_hwrevision(void)
+{
+	if (env_get_ulong("unipi_dram_type", 10, 0xffff) == 0)
+		return "g1 1.0";
+	return "g1 2.0";
+}
+
+static const struct unipi_fdtfix_prop g1_root_props[] = {
+	FDTFIX_FUNC("altboot-hwrevision", g1_hwrevision,
+		    UNIPI_FDTFIX_PROP_NONUL),
+	UNIPI_FDTFIX_IDENTITY,
+};
+
+static const struct unipi_fdtfix_node g1_fdt_fixups[] = {
+	FDTFIX_NODE("/", 0, g1_root_props),
+};
+
 int ft_board_setup(void *blob, struct bd_info  *bd)
 {
-	char tmpstr[20];
-	ulong ddr;
-	ddr = env_get_ulong("unipi_dram_type", 10, 0xffff);
-	if (ddr == 0) {
-		snprintf(tmpstr, sizeof(tmpstr)-1, "g1 1.0");
-	} else {
-		snprintf(tmpstr, sizeof(tmpstr)-1, "g1 2.0");
-	}
-	tmpstr[sizeof(tmpstr)-1]= '\0';
-	fdt_setprop(blob, 0, "altboot-hwrevision", tmpstr, strlen(tmpstr));
-	return ft_unipi_board_setup(blob, bd);
+	return unipi_fdt_fixup(blob, NULL, g1_fdt_fixups,
+			       ARRAY_SIZE(g1_fdt_fixups));
+}
+
+#if IS_ENABLED(CONFIG_UNIPI_NET_PHY)
+int board_phy_config(struct phy_device *phydev)
+{
+	if (phydev->drv->config)
+		phydev->drv->config(phydev);
+	unipi_phy_register(phydev);
+	return 0;
 }
+#endif
 
 int bootmeth_verify_dir(struct bootflow *bflow, struct blk_desc *desc,
                         const char *prefix)
 {
-	ulong ddr;
-	int ret;
-
-	ddr = env_get_ulong("unipi_dram_type", 10, 0xffff);
-	if (ddr == 0)
-		return 0;
+	const char *hwrev = g1_hwrevision();
 
-	ret = bootmeth_try_file(bflow, desc, prefix, "hwrevision.compatible");
-	return ret;
+	/* images without hwrevision.compatible are for g1 1.0 */
+	return unipi_hwrev_verify(bflow, desc, prefix, hwrev,
+				  strcmp(hwrev, "g1 1.0"));
 }
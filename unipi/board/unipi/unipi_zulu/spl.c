@@ -10,6 +10,7 @@
 #include <init.h>
 #include <log.h>
 #include <spl.h>
+#include <vsprintf.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
 #include <asm/mach-imx/iomux-v3.h>
@@ -33,6 +34,9 @@ DECLARE_GLOBAL_DATA_PTR;
 
 void lpddr_patch_timing(void);
 
+/* detected RAM in GB, identity of the variant for FIT config selection */
+static u32 spl_ram_size;
+
 int spl_board_boot_device(enum boot_device boot_dev_spl)
 {
 	switch (boot_dev_spl) {
@@ -130,6 +134,7 @@ static void spl_dram_init(void)
 	}
 	printf("Unipi Zulu, %u GB RAM detected\n", size);
 	writel(size, MCU_BOOTROM_BASE_ADDR);
+	spl_ram_size = size;
 }
 
 
@@ -175,12 +180,43 @@ void spl_board_init(void)
 }
 
 #ifdef CONFIG_SPL_LOAD_FIT
+/* the FIT configurations are built from CONFIG_OF_LIST */
+static bool spl_of_list_has(const char *name)
+{
+	const char *p = CONFIG_OF_LIST;
+	int len = strlen(name);
+
+	while (p) {
+		while (*p == ' ')
+			p++;
+		if (!strncmp(p, name, len) && (p[len] == ' ' || !p[len]))
+			return true;
+		p = strchr(p, ' ');
+	}
+	return false;
+}
+
+/*
+ * Choose the DTB of the RAM variant (unipi-zulu-1g, -2g, -4g). The generic
+ * unipi-zulu matches only if the FIT has no DTB of the variant, so the
+ * order of CONFIG_OF_LIST does not matter. RAM size is the only identity
+ * known this early, the board EEPROM is not read in SPL.
+ */
 int board_fit_config_name_match(const char *name)
 {
-	/* Just empty function now - can't decide what to choose */
+	char variant[32];
+
 	debug("%s: %s\n", __func__, name);
 
-	return 0;
+	snprintf(variant, sizeof(variant), "%s-%ug",
+		 CONFIG_DEFAULT_DEVICE_TREE, spl_ram_size);
+	if (!strcmp(name, variant))
+		return 0;
+	if (!strcmp(name, CONFIG_DEFAULT_DEVICE_TREE) &&
+	    !spl_of_list_has(variant))
+		return 0;
+
+	return -EINVAL;
 }
 #endif
 
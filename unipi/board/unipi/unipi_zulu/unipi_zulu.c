@@ -17,8 +17,10 @@
 #include <linux/delay.h>
 #include <miiphy.h>
 #include <netdev.h>
+#include <time.h>
 #include <usb.h>
 #include <bootmeth.h>
+#include <power/regulator.h>
 
 #include "../common/uniee_values.h"
 #include "../common/unipi_system.h"
@@ -50,6 +52,9 @@ int board_phy_config(struct phy_device *phydev)
 
 	if (phydev->drv->config)
 		phydev->drv->config(phydev);
+#if IS_ENABLED(CONFIG_UNIPI_NET_PHY)
+	unipi_phy_register(phydev);
+#endif
 	return 0;
 }
 #endif
@@ -79,11 +84,50 @@ int board_phys_sdram_size(phys_size_t *size)
 	return 0;
 }
 
+#if IS_ENABLED(CONFIG_UNIPI_ZULU_USB_EARLY_POWER)
+static struct udevice *usb_power_reg;
+static ulong usb_power_on_time;
+
+static void setup_usb_power(void)
+{
+	struct udevice *dev;
+
+	if (regulator_get_by_platname("USB_5V", &dev))
+		return;
+	if (regulator_set_enable(dev, true))
+		return;
+	usb_power_reg = dev;
+	usb_power_on_time = get_timer(0);
+}
+
+/*
+ * called from usb_hub_power_on(), devices on the root hub of the
+ * controller supplied by USB_5V see VBUS since board_init. Other hubs
+ * power their ports now.
+ */
+ulong usb_hub_board_power_on_time(struct usb_device *udev)
+{
+	struct udevice *reg;
+
+	if (!usb_power_on_time || !udev->dev ||
+	    !usb_hub_is_root_hub(udev->dev))
+		return 0;
+	if (device_get_supply_regulator(dev_get_parent(udev->dev),
+					"vbus-supply", &reg) ||
+	    reg != usb_power_reg)
+		return 0;
+	return usb_power_on_time;
+}
+#endif
+
 int board_init(void)
 {
 	if (IS_ENABLED(CONFIG_FEC_MXC))
 		setup_fec();
 
+#if IS_ENABLED(CONFIG_UNIPI_ZULU_USB_EARLY_POWER)
+	setup_usb_power();
+#endif
 	return 0;
 }
 
@@ -168,26 +212,32 @@ int board_late_init(void)
 	return 0;
 }
 
+static const char *zulu_hwrevision(void)
+{
+	return gd->ram_size > SZ_1G ? "zulu 2.0" : "zulu 1.0";
+}
+
+static const struct unipi_fdtfix_prop zulu_root_props[] = {
+	FDTFIX_FUNC("altboot-hwrevision", zulu_hwrevision,
+		    UNIPI_FDTFIX_PROP_NONUL),
+	UNIPI_FDTFIX_IDENTITY,
+};
+
+static const struct unipi_fdtfix_node zulu_fdt_fixups[] = {
+	FDTFIX_NODE("/", 0, zulu_root_props),
+};
+
 int ft_board_setup(void *blob, struct bd_info  *bd)
 {
-	char tmpstr[20];
-	if (gd->ram_size > SZ_1G) {
-		snprintf(tmpstr, sizeof(tmpstr)-1, "zulu 2.0");
-	} else {
-		snprintf(tmpstr, sizeof(tmpstr)-1, "zulu 1.0");
-	}
-	tmpstr[sizeof(tmpstr)-1]= '\0';
-	fdt_setprop(blob, 0, "altboot-hwrevision", tmpstr, strlen(tmpstr));
-	return ft_unipi_board_setup(blob, bd);
+	return unipi_fdt_fixup(blob, NULL, zulu_fdt_fixups,
+			       ARRAY_SIZE(zulu_fdt_fixups));
 }
 
 int bootmeth_verify_dir(struct bootflow *bflow, struct blk_desc *desc,
                         const char *prefix)
 {
-	int ret = 0;
-
-	if (gd->ram_size > SZ_1G)
-		ret = bootmeth_try_file(bflow, desc, prefix, "hwrevision.compatible");
-	return ret;
+	/* images without hwrevision.compatible are for zulu 1.0 */
+	return unipi_hwrev_verify(bflow, desc, prefix, zulu_hwrevision(),
+				  gd->ram_size > SZ_1G);
 }
 #endif   /* XPL_BUILD */
@@ -96,6 +96,29 @@ static int tryboot_set_bootflow(struct udevice *dev, struct bootflow *bflow,
 	return 0;
 }
 
+/*
+ * Boot the first bootflow on label (e.g. mmc0:2) in this U-Boot session.
+ * Returns only if there is no bootflow or all of them failed.
+ */
+static int tryboot_target(const char *label)
+{
+	struct bootflow_iter iter;
+	struct bootflow bflow;
+	int ret, i;
+
+	for (i = 0, ret = bootflow_scan_first(NULL, label, &iter,
+					      BOOTFLOWIF_HUNT |
+					      BOOTFLOWIF_SKIP_GLOBAL, &bflow);
+	     i < 1000 && ret != -ENODEV;
+	     i++, ret = bootflow_scan_next(&iter, &bflow)) {
+		if (!ret)
+			bootflow_run_boot(&iter, &bflow);
+		bootflow_free(&bflow);
+	}
+	bootflow_iter_uninit(&iter);
+
+	return -ENOENT;
+}
 
 static int tryboot_boot(struct udevice *dev, struct bootflow *bflow)
 {
@@ -114,7 +137,11 @@ static int tryboot_boot(struct udevice *dev, struct bootflow *bflow)
 			}
 		}
 		printf("TRYBOOT: %s\n", bflow->buf);
-		run_commandf("bootflow scan -b %s", bflow->buf);
+		/* mark the trial boot, it must not be remembered as regular */
+		env_set("tryboot_label", bflow->buf);
+		tryboot_target(bflow->buf);
+		env_set("tryboot_label", NULL);
+		/* target failed, bootcount is 0 now - next boot is regular */
 		do_reset(NULL, 0, 0, NULL);
 		return -1;
 	} else {
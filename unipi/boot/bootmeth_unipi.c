@@ -0,0 +1,638 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Bootmethod for booting Linux described by a key=value config file
+ *
+ * Copyright (C) 2026 Miroslav Ondra
+ * Author: Miroslav Ondra <ondra@unipi.technology>
+ *
+ * Does the work of the usual boot.scr (kernel, ramdisk, dtb, overlays,
+ * auxiliary core firmware, bootargs) without the command interpreter.
+ * Sample unipi.conf:
+ *
+ *   kernel=vmlinux-6.12.66-cip16
+ *   fdt=unipi-zulu.dtb
+ *   overlays=unipi_s107
+ *   # ramdisk=initrd.img
+ *   # root=PARTUUID=6c9d1a3e-02
+ *   # args=systemd.gpt_auto=no fsck.repair=yes
+ *
+ * fdt defaults to ${unipi_fdt} or ${fdtfile}, auxfw to ${aux_core_fw_name},
+ * root to PARTUUID of the partition of the config file (U-Boot and Linux
+ * mmc numbering differ). ${clock} and ${extra} are appended to bootargs
+ * like in the sample boot.scr.
+ *
+ * Without overlays in unipi.conf ${unipi_overlays} is used if set, else
+ * the overlays are chosen by the board model and SKU from the EEPROM:
+ * first from overlays/overlays.map of the image, lines
+ * '<model> [sku=<n>] <overlay>...' (a line with matching SKU wins), then
+ * ${unipi_overlays_default} set by the board code. Needs ID_EEPROM, Zulu
+ * has no model identity. Overlays are applied in order, the first one that
+ * can't be loaded or applied stops the chain and the tree with the
+ * overlays before it is booted.
+ *
+ * fdt=firmware (or unipi_fdt=firmware set by the board) boots with the
+ * tree U-Boot was started with, i.e. the one passed in by the Raspberry Pi
+ * firmware on Edge. Nothing is loaded, U-Boot fixups are applied as usual.
+ * The firmware applied the overlays of config.txt already, overlays by
+ * model are not added, only those of unipi.conf or ${unipi_overlays}.
+ */
+
+#define LOG_CATEGORY UCLASS_BOOTSTD
+
+#include <blk.h>
+#include <bootflow.h>
+#include <bootm.h>
+#include <bootmeth.h>
+#include <bootstd.h>
+#include <command.h>
+#include <dm.h>
+#include <env.h>
+#include <fs.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <part.h>
+#include <vsprintf.h>
+#include <asm/global_data.h>
+#include <linux/libfdt.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define UNIPI_CONF_FNAME	"unipi.conf"
+#define UNIPI_CONF_MAX		0x1000
+/* last good tree, scratch tree and overlays share the area at fdt_addr_r */
+#define UNIPI_SCRATCH_OFFSET	0x60000
+#define UNIPI_OVERLAY_OFFSET	0xc0000
+/* ends 1 MiB above fdt_addr_r, where ramdisk_addr_r is on Edge */
+#define UNIPI_OVERLAY_SPACE	0x40000
+#define UNIPI_OVERLAYS_MAX	16
+#define UNIPI_FDT_EXTRA		8192
+#define UNIPI_FDT_FIRMWARE	"firmware"
+#define UNIPI_OVERLAY_MAP	"overlays/overlays.map"
+#define UNIPI_MAP_MAX		0x2000
+
+struct unipi_overlay {
+	const char *name;
+	void *fdto;
+};
+
+enum unipi_key {
+	UNIPI_KERNEL,
+	UNIPI_RAMDISK,
+	UNIPI_FDT,
+	UNIPI_OVERLAYS,
+	UNIPI_AUXFW,
+	UNIPI_ROOT,
+	UNIPI_ARGS,
+	UNIPI_KEY_COUNT,
+};
+
+static const char *const unipi_keys[UNIPI_KEY_COUNT] = {
+	"kernel", "ramdisk", "fdt", "overlays", "auxfw", "root", "args",
+};
+
+struct unipi_conf {
+	const char *val[UNIPI_KEY_COUNT];
+};
+
+/* values point into buf */
+static int unipi_parse_conf(char *buf, struct unipi_conf *conf)
+{
+	char *line, *val;
+	int i;
+
+	memset(conf, 0, sizeof(*conf));
+	while ((line = strsep(&buf, "\n"))) {
+		line = skip_spaces(line);
+		if (*line == '#' || !*line)
+			continue;
+		val = strchr(line, '=');
+		if (!val)
+			return -EINVAL;
+		*val++ = '\0';
+		strim(line);
+		for (i = 0; i < UNIPI_KEY_COUNT; i++) {
+			if (!strcmp(line, unipi_keys[i])) {
+				conf->val[i] = strim(val);
+				break;
+			}
+		}
+		if (i == UNIPI_KEY_COUNT)
+			log_warning("unipi.conf: unknown key %s\n", line);
+	}
+	if (!conf->val[UNIPI_FDT])
+		conf->val[UNIPI_FDT] = env_get("unipi_fdt");
+	if (!conf->val[UNIPI_FDT])
+		conf->val[UNIPI_FDT] = env_get("fdtfile");
+	if (!conf->val[UNIPI_AUXFW])
+		conf->val[UNIPI_AUXFW] = env_get("aux_core_fw_name");
+	if (!conf->val[UNIPI_KERNEL] || !conf->val[UNIPI_FDT])
+		return -ENOENT;
+	return 0;
+}
+
+static int unipi_check(struct udevice *dev, struct bootflow_iter *iter)
+{
+	if (bootflow_iter_check_blk(iter))
+		return log_msg_ret("blk", -ENOTSUPP);
+	return 0;
+}
+
+static int unipi_read_bootflow(struct udevice *dev, struct bootflow *bflow)
+{
+	struct blk_desc *desc = NULL;
+	const char *const *prefixes;
+	struct udevice *bootstd;
+	const char *prefix;
+	int ret, i;
+
+	ret = uclass_first_device_err(UCLASS_BOOTSTD, &bootstd);
+	if (ret)
+		return log_msg_ret("std", ret);
+
+	/* We require a partition table */
+	if (!bflow->part)
+		return -ENOENT;
+	desc = dev_get_uclass_plat(bflow->blk);
+
+	prefixes = bootstd_get_prefixes(bootstd);
+	i = 0;
+	do {
+		prefix = prefixes ? prefixes[i] : NULL;
+		ret = bootmeth_verify_dir(bflow, desc, prefix);
+		if (ret)
+			continue;
+		ret = bootmeth_try_file(bflow, desc, prefix, UNIPI_CONF_FNAME);
+	} while (ret && prefixes && prefixes[++i]);
+	if (ret)
+		return log_msg_ret("try", ret);
+
+	bflow->subdir = strdup(prefix ? prefix : "");
+	if (!bflow->subdir)
+		return log_msg_ret("prefix", -ENOMEM);
+
+	ret = bootmeth_alloc_file(bflow, UNIPI_CONF_MAX, 1, BFI_UNIPI_CFG);
+	if (ret)
+		return log_msg_ret("read", ret);
+	bflow->os_name = strdup("unipi");
+
+	return 0;
+}
+
+static int unipi_set_bootflow(struct udevice *dev, struct bootflow *bflow,
+			      char *buf, int size)
+{
+	buf[size] = '\0';
+	bflow->buf = buf;
+	bflow->size = size;
+	bflow->state = BOOTFLOWST_READY;
+	return 0;
+}
+
+/*
+ * Load a file from the bootflow directory. Goes through the same hooks as
+ * the 'load' command, so prefetched images are used.
+ */
+static int unipi_load(struct bootflow *bflow, const char *fname, ulong addr,
+		      ulong *sizep)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(bflow->blk);
+	const char *ifname = blk_get_uclass_name(desc->uclass_id);
+	char path[200], dev_part[16];
+	loff_t len;
+	int ret;
+
+	snprintf(path, sizeof(path), "%s%s", bflow->subdir, fname);
+	snprintf(dev_part, sizeof(dev_part), "%x:%x", desc->devnum, bflow->part);
+	printf("Loading %s\n", path);
+
+	ret = bootmeth_setup_fs(bflow, desc);
+	if (ret)
+		return log_msg_ret("fs", ret);
+	if (fs_load_prefetched(ifname, dev_part, path, addr, 0, 0, &len) == 0) {
+		fs_close();
+	} else {
+		ret = fs_read(path, addr, 0, 0, &len);
+		if (ret)
+			return log_msg_ret("load", ret);
+	}
+
+	if (sizep)
+		*sizep = len;
+	return 0;
+}
+
+static bool unipi_exists(struct bootflow *bflow, const char *fname)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(bflow->blk);
+	char path[200];
+
+	snprintf(path, sizeof(path), "%s%s", bflow->subdir, fname);
+	if (bootmeth_setup_fs(bflow, desc))
+		return false;
+	return fs_exists(path);
+}
+
+/* read a small text file from the bootflow directory */
+static char *unipi_read_text(struct bootflow *bflow, const char *fname,
+			     loff_t max)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(bflow->blk);
+	char path[200];
+	loff_t size, len;
+	char *buf;
+
+	snprintf(path, sizeof(path), "%s%s", bflow->subdir, fname);
+	if (bootmeth_setup_fs(bflow, desc) || fs_size(path, &size) ||
+	    size > max)
+		return NULL;
+	buf = malloc(size + 1);
+	if (!buf)
+		return NULL;
+	if (bootmeth_setup_fs(bflow, desc) ||
+	    fs_read(path, map_to_sysmem(buf), 0, size, &len)) {
+		free(buf);
+		return NULL;
+	}
+	buf[len] = '\0';
+	return buf;
+}
+
+static char *unipi_map_overlays(char *map, const char *model, ulong sku)
+{
+	char *line, *tok, *found = NULL;
+
+	while ((line = strsep(&map, "\n"))) {
+		line = skip_spaces(line);
+		tok = strsep(&line, " \t");
+		if (!tok || *tok == '#' || strcasecmp(tok, model) || !line)
+			continue;
+		line = skip_spaces(line);
+		if (!strncmp(line, "sku=", 4)) {
+			if (simple_strtoul(line + 4, &line, 10) != sku)
+				continue;
+			return strim(line);
+		}
+		if (!found)
+			found = strim(line);
+	}
+	return found;
+}
+
+/*
+ * overlays for the board model, allocated; with by_model false (firmware
+ * tree, config.txt overlays are applied already) only ${unipi_overlays}
+ */
+static char *unipi_model_overlays(struct bootflow *bflow, bool by_model)
+{
+	const char *model = env_get("unipi_model");
+	char *map, *overlays = NULL;
+
+	if (env_get("unipi_overlays")) {
+		overlays = strdup(env_get("unipi_overlays"));
+	} else if (by_model && model) {
+		map = unipi_read_text(bflow, UNIPI_OVERLAY_MAP, UNIPI_MAP_MAX);
+		if (map) {
+			overlays = unipi_map_overlays(map, model,
+						      env_get_ulong("unipi_sku",
+								    10, 0));
+			if (overlays)
+				overlays = strdup(overlays);
+			free(map);
+		}
+	}
+	if (!overlays && by_model && env_get("unipi_overlays_default"))
+		overlays = strdup(env_get("unipi_overlays_default"));
+	if (overlays)
+		printf("Overlays for %s: %s\n", model ? model : "board",
+		       overlays);
+	return overlays;
+}
+
+/*
+ * Load the overlays one after another to the overlay area, 8 byte aligned.
+ * ovs gets the loaded ones, names point into list. Loading stops at the
+ * first overlay that can't be loaded, later ones may depend on it. Returns
+ * 0 if all of them were loaded.
+ */
+static int unipi_load_overlays(struct bootflow *bflow, char *list,
+			       ulong addr, struct unipi_overlay *ovs,
+			       int *countp)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(bflow->blk);
+	ulong end = addr + UNIPI_OVERLAY_SPACE;
+	char fname[64], path[200];
+	int count = 0, ret = 0;
+	void *fdto;
+	loff_t size;
+	ulong len;
+	char *ov;
+
+	while ((ov = strsep(&list, " \t"))) {
+		if (!*ov)
+			continue;
+		if (count == UNIPI_OVERLAYS_MAX) {
+			printf("Overlay %s: too many overlays\n", ov);
+			ret = -E2BIG;
+			break;
+		}
+		snprintf(fname, sizeof(fname), "overlays/%s.dtb", ov);
+		snprintf(path, sizeof(path), "%s%s", bflow->subdir, fname);
+		if (bootmeth_setup_fs(bflow, desc) || fs_size(path, &size)) {
+			printf("Overlay %s not found\n", ov);
+			ret = -ENOENT;
+			break;
+		}
+		if (addr + size > end) {
+			printf("Overlay %s: no room\n", ov);
+			ret = -E2BIG;
+			break;
+		}
+		ret = unipi_load(bflow, fname, addr, &len);
+		if (ret) {
+			printf("Overlay %s: %d\n", ov, ret);
+			break;
+		}
+		fdto = map_sysmem(addr, len);
+		if (fdt_check_header(fdto) || fdt_totalsize(fdto) > len) {
+			printf("Overlay %s: not a device tree\n", ov);
+			ret = -EINVAL;
+			break;
+		}
+		ovs[count].name = ov;
+		ovs[count++].fdto = fdto;
+		addr += ALIGN(len, 8);
+	}
+	if (ret)
+		printf("Overlay %s and the rest skipped\n", ov);
+	*countp = count;
+	return ret;
+}
+
+/*
+ * Apply the loaded overlays in order. Each one is applied to a scratch
+ * copy of the last good tree (libfdt leaves the tree damaged on error) and
+ * the copy becomes the good tree only on success. The first failing
+ * overlay stops the chain, the following ones may depend on it, and the
+ * last good tree is kept. Returns 0 if all of them were applied.
+ */
+static int unipi_apply_overlays(ulong fdt_addr, struct unipi_overlay *ovs,
+				int count)
+{
+	void *fdt = map_sysmem(fdt_addr, 0);
+	void *scratch = map_sysmem(fdt_addr + UNIPI_SCRATCH_OFFSET, 0);
+	void *good = fdt, *tmp;
+	int i, ret = 0, size;
+
+	for (i = 0; i < count; i++) {
+		size = fdt_totalsize(good) + fdt_totalsize(ovs[i].fdto) +
+		       UNIPI_FDT_EXTRA;
+		if (size > UNIPI_SCRATCH_OFFSET)
+			ret = -FDT_ERR_NOSPACE;
+		else
+			ret = fdt_open_into(good, scratch, size);
+		if (!ret)
+			ret = fdt_overlay_apply_verbose(scratch, ovs[i].fdto);
+		if (ret) {
+			printf("Overlay %s failed: %s, the rest skipped\n",
+			       ovs[i].name, fdt_strerror(ret));
+			ret = -EINVAL;
+			break;
+		}
+		/* commit */
+		tmp = good;
+		good = scratch;
+		scratch = tmp;
+	}
+
+	if (good != fdt)
+		memcpy(fdt, good, fdt_totalsize(good));
+	return ret;
+}
+
+/* copy of the tree U-Boot was started with, with room for the fixups */
+static int unipi_firmware_fdt(ulong fdt_addr)
+{
+	int size = fdt_totalsize(gd->fdt_blob) + UNIPI_FDT_EXTRA;
+	int ret;
+
+	if (size > UNIPI_SCRATCH_OFFSET)
+		return log_msg_ret("fw", -E2BIG);
+	printf("Using device tree passed by firmware\n");
+	ret = fdt_open_into(gd->fdt_blob, map_sysmem(fdt_addr, size), size);
+	if (ret) {
+		printf("Firmware device tree: %s\n", fdt_strerror(ret));
+		return log_msg_ret("fw", -EINVAL);
+	}
+	return 0;
+}
+
+/*
+ * Base tree with overlays at fdt_addr. From the first overlay that can't be
+ * loaded or applied on, the overlays are left out.
+ */
+static int unipi_build_fdt(struct bootflow *bflow, const char *fdtfile,
+			   const char *overlays, ulong fdt_addr)
+{
+	struct unipi_overlay ovs[UNIPI_OVERLAYS_MAX];
+	void *fdt = map_sysmem(fdt_addr, 0);
+	int count;
+	char *list;
+
+	if (!IS_ENABLED(CONFIG_OF_LIBFDT_OVERLAY)) {
+		printf("Overlays not supported, skipped\n");
+		return 0;
+	}
+	if (fdt_path_offset(fdt, "/__symbols__") < 0) {
+		printf("%s has no symbols, overlays skipped\n", fdtfile);
+		return 0;
+	}
+
+	list = strdup(overlays);
+	if (!list)
+		return -ENOMEM;
+	/* the overlays loaded before a failure are still applied */
+	unipi_load_overlays(bflow, list, fdt_addr + UNIPI_OVERLAY_OFFSET, ovs,
+			    &count);
+	unipi_apply_overlays(fdt_addr, ovs, count);
+	free(list);
+	return 0;
+}
+
+static int unipi_set_bootargs(struct bootflow *bflow, struct unipi_conf *conf)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(bflow->blk);
+	const char *extra = env_get("extra");
+	const char *clock = env_get("clock");
+	const char *console = env_get("console");
+	const char *baudrate = env_get("baudrate");
+	const char *fstype = NULL;
+	char root[48], rootpar[48], extrapar[256];
+	struct disk_partition info;
+	char *bootargs;
+	int ret;
+
+	if (!conf->val[UNIPI_ROOT]) {
+		if (part_get_info(desc, bflow->part, &info) ||
+		    !*disk_partition_uuid(&info)) {
+			printf("%s: no PARTUUID, set root in %s\n",
+			       bflow->name, UNIPI_CONF_FNAME);
+			return log_msg_ret("uuid", -ENOENT);
+		}
+		snprintf(root, sizeof(root), "PARTUUID=%s",
+			 disk_partition_uuid(&info));
+		conf->val[UNIPI_ROOT] = root;
+	}
+	if (!bootmeth_setup_fs(bflow, desc)) {
+		fstype = fs_get_type_name();
+		fs_close();
+	}
+	if (fstype && !strcmp(fstype, "ext4"))
+		snprintf(rootpar, sizeof(rootpar), "rootfstype=%s rw rootwait",
+			 fstype);
+	else
+		strlcpy(rootpar, "rw rootwait", sizeof(rootpar));
+	if (extra && *extra && console && baudrate)
+		snprintf(extrapar, sizeof(extrapar), "console=%s,%s %s",
+			 console, baudrate, extra);
+	else if (extra && *extra)
+		strlcpy(extrapar, extra, sizeof(extrapar));
+	else
+		strlcpy(extrapar, "panic=10 quiet", sizeof(extrapar));
+
+	bootargs = malloc(CONFIG_SYS_CBSIZE);
+	if (!bootargs)
+		return -ENOMEM;
+	snprintf(bootargs, CONFIG_SYS_CBSIZE, "root=%s %s %s %s %s",
+		 conf->val[UNIPI_ROOT], rootpar,
+		 conf->val[UNIPI_ARGS] ? conf->val[UNIPI_ARGS] :
+		 "systemd.gpt_auto=no fsck.repair=yes",
+		 clock ? clock : "", extrapar);
+	ret = env_set("bootargs", bootargs);
+	free(bootargs);
+	return ret;
+}
+
+static int unipi_boot_conf(struct bootflow *bflow, struct unipi_conf *conf,
+			   ulong kernel_addr, ulong ramdisk_addr,
+			   ulong fdt_addr)
+{
+	char kernel_str[20], ramdisk_str[40], fdt_str[20];
+	struct bootm_info bmi;
+	char *overlays;
+	ulong size, aux_addr;
+	bool firmware;
+	int ret;
+
+	bootm_init(&bmi);
+	ret = unipi_load(bflow, conf->val[UNIPI_KERNEL], kernel_addr, NULL);
+	if (ret)
+		return ret;
+	snprintf(kernel_str, sizeof(kernel_str), "%lx", kernel_addr);
+	bmi.addr_img = kernel_str;
+
+	if (conf->val[UNIPI_RAMDISK] && *conf->val[UNIPI_RAMDISK]) {
+		ret = unipi_load(bflow, conf->val[UNIPI_RAMDISK], ramdisk_addr,
+				 &size);
+		if (ret)
+			return ret;
+		snprintf(ramdisk_str, sizeof(ramdisk_str), "%lx:%lx",
+			 ramdisk_addr, size);
+		bmi.conf_ramdisk = ramdisk_str;
+	}
+
+	firmware = !strcmp(conf->val[UNIPI_FDT], UNIPI_FDT_FIRMWARE);
+	if (firmware)
+		ret = unipi_firmware_fdt(fdt_addr);
+	else
+		ret = unipi_load(bflow, conf->val[UNIPI_FDT], fdt_addr, NULL);
+	if (ret)
+		return ret;
+	if (conf->val[UNIPI_OVERLAYS]) {
+		overlays = strdup(conf->val[UNIPI_OVERLAYS]);
+	} else {
+		overlays = unipi_model_overlays(bflow, !firmware);
+	}
+	if (overlays && *overlays)
+		ret = unipi_build_fdt(bflow, conf->val[UNIPI_FDT], overlays,
+				      fdt_addr);
+	free(overlays);
+	if (ret)
+		return ret;
+	snprintf(fdt_str, sizeof(fdt_str), "%lx", fdt_addr);
+	bmi.conf_fdt = fdt_str;
+
+	/* without a load address there is no place for the firmware */
+	aux_addr = env_get_hex("aux_core_fw_addr_r", 0);
+	if (conf->val[UNIPI_AUXFW] && aux_addr && env_get("boot_aux_core") &&
+	    unipi_exists(bflow, conf->val[UNIPI_AUXFW]) &&
+	    !unipi_load(bflow, conf->val[UNIPI_AUXFW], aux_addr, NULL))
+		run_command("run boot_aux_core", 0);
+
+	ret = unipi_set_bootargs(bflow, conf);
+	if (ret)
+		return log_msg_ret("args", ret);
+
+	return booti_run(&bmi);
+}
+
+static int unipi_boot(struct udevice *dev, struct bootflow *bflow)
+{
+	ulong kernel_addr = env_get_hex("kernel_addr_r", 0);
+	ulong ramdisk_addr = env_get_hex("ramdisk_addr_r", 0);
+	ulong fdt_addr = env_get_hex("fdt_addr_r", 0);
+	struct unipi_conf conf;
+	char *buf;
+	int ret;
+
+	if (!kernel_addr || !fdt_addr)
+		return log_msg_ret("addr", -EINVAL);
+	/* keep bflow->buf intact for 'bootflow info' and another attempt */
+	buf = strdup(bflow->buf);
+	if (!buf)
+		return log_msg_ret("buf", -ENOMEM);
+	ret = unipi_parse_conf(buf, &conf);
+	if (ret) {
+		printf("%s%s: kernel or fdt missing\n", bflow->subdir,
+		       UNIPI_CONF_FNAME);
+		free(buf);
+		return log_msg_ret("conf", ret);
+	}
+	ret = unipi_boot_conf(bflow, &conf, kernel_addr, ramdisk_addr,
+			      fdt_addr);
+	free(buf);
+
+	return log_msg_ret("boot", ret);
+}
+
+static int unipi_bootmeth_bind(struct udevice *dev)
+{
+	struct bootmeth_uc_plat *plat = dev_get_uclass_plat(dev);
+
+	plat->desc = IS_ENABLED(CONFIG_BOOTSTD_FULL) ?
+		"Unipi boot config from a block device" : "unipi";
+
+	return 0;
+}
+
+static struct bootmeth_ops unipi_bootmeth_ops = {
+	.check		= unipi_check,
+	.read_bootflow	= unipi_read_bootflow,
+	.set_bootflow	= unipi_set_bootflow,
+	.read_file	= bootmeth_common_read_file,
+	.boot		= unipi_boot,
+};
+
+static const struct udevice_id unipi_bootmeth_ids[] = {
+	{ .compatible = "u-boot,unipi" },
+	{ }
+};
+
+/* Put an number before 'unipi' to provide a default ordering */
+U_BOOT_DRIVER(bootmeth_3unipi) = {
+	.name		= "bootmeth_unipi",
+	.id		= UCLASS_BOOTMETH,
+	.of_match	= unipi_bootmeth_ids,
+	.ops		= &unipi_bootmeth_ops,
+	.bind		= unipi_bootmeth_bind,
+};